@@ -0,0 +1,155 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#include "AudioAnalyzer.h"
+
+using namespace juce;
+
+AudioAnalyzer::AudioAnalyzer() { prepare(sampleRate); }
+
+void AudioAnalyzer::prepare(double newSampleRate) {
+    sampleRate = newSampleRate;
+
+    inputFifo.calloc(FFT_SIZE);
+    fftData.calloc(2 * FFT_SIZE);
+    productSpectrum.calloc(FFT_SIZE / 2);
+    inputFifoIndex = 0;
+    samplesSinceLastFrame = 0;
+    resultFifo.reset();
+
+    // Log-spaced band edges, in FFT bins. Every band gets at least one bin.
+    for (int band = 0; band <= NB_OF_BANDS; band++) {
+        auto frequency = MIN_FREQUENCY * std::pow(MAX_FREQUENCY / MIN_FREQUENCY, band / static_cast<float>(NB_OF_BANDS));
+        bandEdges[band] = jlimit(1, FFT_SIZE / 2, roundToInt(frequency * FFT_SIZE / sampleRate));
+        if (band > 0 && bandEdges[band] <= bandEdges[band - 1])
+            bandEdges[band] = jmin(bandEdges[band - 1] + 1, FFT_SIZE / 2);
+    }
+}
+
+void AudioAnalyzer::pushSamples(const float* samples, int nbOfSamples) {
+    while (nbOfSamples > 0) {
+        const auto nbToCopy = jmin(nbOfSamples, FFT_SIZE - inputFifoIndex, HOP_SIZE - samplesSinceLastFrame);
+        FloatVectorOperations::copy(inputFifo.getData() + inputFifoIndex, samples, nbToCopy);
+
+        samples += nbToCopy;
+        nbOfSamples -= nbToCopy;
+        inputFifoIndex = (inputFifoIndex + nbToCopy) % FFT_SIZE;
+        samplesSinceLastFrame += nbToCopy;
+
+        if (samplesSinceLastFrame == HOP_SIZE) {
+            samplesSinceLastFrame = 0;
+            analyseFrame();
+        }
+    }
+}
+
+bool AudioAnalyzer::popResult(Result& result) {
+    const auto nbReady = resultFifo.getNumReady();
+    if (nbReady == 0)
+        return false;
+
+    // Only the newest result is of interest, the older ones are skipped
+    const auto scope = resultFifo.read(nbReady);
+    result = scope.blockSize2 > 0 ? results[scope.startIndex2 + scope.blockSize2 - 1] : results[scope.startIndex1 + scope.blockSize1 - 1];
+    return true;
+}
+
+void AudioAnalyzer::analyseFrame() {
+    // Unroll the circular input buffer, oldest sample first
+    auto* data = fftData.getData();
+    const auto nbOfOldest = FFT_SIZE - inputFifoIndex;
+    FloatVectorOperations::copy(data, inputFifo.getData() + inputFifoIndex, nbOfOldest);
+    FloatVectorOperations::copy(data + nbOfOldest, inputFifo.getData(), inputFifoIndex);
+    FloatVectorOperations::clear(data + FFT_SIZE, FFT_SIZE);
+
+    Result result;
+    const auto range = FloatVectorOperations::findMinAndMax(data, FFT_SIZE);
+    result.levelDb = Decibels::gainToDecibels(jmax(std::abs(range.getStart()), std::abs(range.getEnd())));
+
+    window.multiplyWithWindowingTable(data, static_cast<size_t>(FFT_SIZE));
+    fft.performFrequencyOnlyForwardTransform(data, true);
+
+    // Spectrum summary in log-spaced bands
+    for (int band = 0; band < NB_OF_BANDS; band++)
+        result.bands[band] = FloatVectorOperations::findMaximum(data + bandEdges[band], jmax(1, bandEdges[band + 1] - bandEdges[band]));
+
+    const auto loudestBand = FloatVectorOperations::findMaximum(result.bands, NB_OF_BANDS);
+    if (loudestBand > 0.0f)
+        FloatVectorOperations::multiply(result.bands, 1.0f / loudestBand, NB_OF_BANDS);
+
+    // Below this level, there is nothing worth finding a pitch for
+    result.fundamentalHz = result.levelDb > -60.0f ? findFundamental(data) : 0.0f;
+
+    // If the UI is not keeping up, the result is dropped rather than waiting
+    const auto scope = resultFifo.write(1);
+    if (scope.blockSize1 > 0)
+        results[scope.startIndex1] = result;
+    else if (scope.blockSize2 > 0)
+        results[scope.startIndex2] = result;
+}
+
+float AudioAnalyzer::findFundamental(const float* magnitudes) const {
+    // Harmonic product spectrum: the spectrum is multiplied by its decimated copies, so the harmonics pile up on the fundamental
+    constexpr int nbOfBins = FFT_SIZE / 2;
+    auto* product = productSpectrum.getData();
+    FloatVectorOperations::copy(product, magnitudes, nbOfBins);
+
+    for (int harmonic = 2; harmonic <= NB_OF_HARMONICS; harmonic++)
+        for (int bin = 0; bin < nbOfBins / harmonic; bin++)
+            product[bin] *= magnitudes[bin * harmonic];
+
+    const auto minBin = jmax(1, roundToInt(MIN_FREQUENCY * FFT_SIZE / sampleRate));
+    const auto maxBin = jmin(nbOfBins / NB_OF_HARMONICS, roundToInt(MAX_FREQUENCY * FFT_SIZE / sampleRate));
+    if (maxBin <= minBin + 1)
+        return 0.0f;
+
+    int peakBin = minBin;
+    for (int bin = minBin + 1; bin < maxBin; bin++)
+        if (product[bin] > product[peakBin])
+            peakBin = bin;
+
+    // Parabolic interpolation around the peak of the magnitude spectrum for a sub-bin estimate
+    const auto left = magnitudes[peakBin - 1], centre = magnitudes[peakBin], right = magnitudes[peakBin + 1];
+    const auto denominator = left - 2.0f * centre + right;
+    const auto offset = denominator != 0.0f ? 0.5f * (left - right) / denominator : 0.0f;
+
+    return static_cast<float>((peakBin + jlimit(-0.5f, 0.5f, offset)) * sampleRate / FFT_SIZE);
+}
+
+bool AudioAnalyzer::analyseFile(const File& file, Array<Result>& fileResults) {
+    AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+    std::unique_ptr<AudioFormatReader> reader(formatManager.createReaderFor(file));
+    if (reader == nullptr)
+        return false;
+
+    AudioAnalyzer analyzer;
+    analyzer.prepare(reader->sampleRate);
+
+    AudioBuffer<float> buffer(1, FFT_SIZE);
+    for (int64 position = 0; position < reader->lengthInSamples; position += FFT_SIZE) {
+        const auto nbOfSamples = static_cast<int>(jmin(static_cast<int64>(FFT_SIZE), reader->lengthInSamples - position));
+        // Only the first channel is analysed
+        reader->read(&buffer, 0, nbOfSamples, position, true, false);
+        analyzer.pushSamples(buffer.getReadPointer(0), nbOfSamples);
+
+        const auto nbReady = analyzer.resultFifo.getNumReady();
+        const auto scope = analyzer.resultFifo.read(nbReady);
+        for (int i = 0; i < scope.blockSize1; i++)
+            fileResults.add(analyzer.results[scope.startIndex1 + i]);
+        for (int i = 0; i < scope.blockSize2; i++)
+            fileResults.add(analyzer.results[scope.startIndex2 + i]);
+    }
+    return true;
+}
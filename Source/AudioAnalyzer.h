@@ -0,0 +1,74 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+using namespace juce;
+
+// Spectrum and pitch analyzer for the synth's audio output. Everything is allocated in prepare(), so pushSamples()
+// can be called from the audio thread. Results are handed to the UI through a lock-free FIFO.
+class AudioAnalyzer {
+  public:
+    static const int FFT_ORDER = 12;
+    static const int FFT_SIZE = 1 << FFT_ORDER;
+    static const int NB_OF_BANDS = 32;
+
+    struct Result {
+        float fundamentalHz = 0.0f;
+        float levelDb = -100.0f;
+        // Magnitudes in log-spaced bands from MIN_FREQUENCY to MAX_FREQUENCY, normalised so the loudest band is 1
+        float bands[NB_OF_BANDS] = {};
+    };
+
+    AudioAnalyzer();
+
+    void prepare(double sampleRate);
+    // Safe to call from the audio thread: no allocations and no locks
+    void pushSamples(const float* samples, int nbOfSamples);
+    // Returns the newest result available, if any
+    bool popResult(Result& result);
+
+    // Runs the analyzer over a whole audio file, for testing and offline analysis without a synth
+    static bool analyseFile(const File& file, Array<Result>& results);
+
+  private:
+    void analyseFrame();
+    float findFundamental(const float* magnitudes) const;
+
+    static constexpr float MIN_FREQUENCY = 20.0f;
+    static constexpr float MAX_FREQUENCY = 8000.0f;
+    // Number of harmonics used by the harmonic product spectrum to find the fundamental
+    static const int NB_OF_HARMONICS = 4;
+    // A new frame is analysed every half FFT
+    static const int HOP_SIZE = FFT_SIZE / 2;
+    static const int RESULT_QUEUE_SIZE = 16;
+
+    dsp::FFT fft{FFT_ORDER};
+    dsp::WindowingFunction<float> window{static_cast<size_t>(FFT_SIZE), dsp::WindowingFunction<float>::hann};
+    double sampleRate = 44100.0;
+
+    HeapBlock<float> inputFifo;
+    int inputFifoIndex = 0;
+    int samplesSinceLastFrame = 0;
+    HeapBlock<float> fftData;
+    HeapBlock<float> productSpectrum;
+    int bandEdges[NB_OF_BANDS + 1] = {};
+
+    AbstractFifo resultFifo{RESULT_QUEUE_SIZE};
+    Result results[RESULT_QUEUE_SIZE];
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioAnalyzer)
+};
@@ -0,0 +1,56 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#include "ConnectionCache.h"
+
+using namespace juce;
+
+ConnectionCache::ConnectionCache() : properties(getOptions()) {}
+
+PropertiesFile::Options ConnectionCache::getOptions() {
+    PropertiesFile::Options options;
+    options.applicationName = "SideQick";
+    options.folderName = "SideQick";
+    options.filenameSuffix = ".settings";
+    options.osxLibrarySubFolder = "Application Support";
+    return options;
+}
+
+bool ConnectionCache::find(const String& midiInName, const String& midiOutName, KnownSynth& knownSynth) {
+    const auto entry = properties.getXmlValue(getKey(midiInName, midiOutName));
+    if (entry == nullptr || !entry->hasAttribute("channel"))
+        return false;
+
+    knownSynth.channel = jlimit(0, 15, entry->getIntAttribute("channel"));
+
+    MemoryBlock deviceIdData;
+    deviceIdData.loadFromHexString(entry->getStringAttribute("deviceId"));
+    knownSynth.deviceIdMessage = MidiMessage();
+    if (!deviceIdData.isEmpty())
+        knownSynth.deviceIdMessage = MidiMessage::createSysExMessage(deviceIdData.getData(), static_cast<int>(deviceIdData.getSize()));
+    return true;
+}
+
+void ConnectionCache::store(const String& midiInName, const String& midiOutName, int channel, const MidiMessage& deviceIdMessage) {
+    XmlElement entry("SYNTH");
+    entry.setAttribute("channel", channel);
+    if (deviceIdMessage.isSysEx())
+        entry.setAttribute("deviceId", String::toHexString(deviceIdMessage.getSysExData(), deviceIdMessage.getSysExDataSize(), 0));
+
+    properties.setValue(getKey(midiInName, midiOutName), &entry);
+    properties.setValue(LAST_MIDI_IN_KEY, midiInName);
+    properties.setValue(LAST_MIDI_OUT_KEY, midiOutName);
+}
+
+void ConnectionCache::forget(const String& midiInName, const String& midiOutName) { properties.removeValue(getKey(midiInName, midiOutName)); }
@@ -0,0 +1,51 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+using namespace juce;
+
+// Remembers the synths found on each pair of MIDI ports between launches. The raw DeviceInquiry response is kept, so the
+// model and OS version are decoded exactly like on a full connection, and the channel saves probing for old ESQ-1s.
+class ConnectionCache {
+  public:
+    struct KnownSynth {
+        int channel = 0;
+        // Empty for the ESQ-1s that don't answer the DeviceInquiry request
+        MidiMessage deviceIdMessage;
+    };
+
+    ConnectionCache();
+
+    bool find(const String& midiInName, const String& midiOutName, KnownSynth& knownSynth);
+    void store(const String& midiInName, const String& midiOutName, int channel, const MidiMessage& deviceIdMessage);
+    void forget(const String& midiInName, const String& midiOutName);
+
+    // Ports of the last synth we connected to, to select them again on launch
+    String getLastMidiIn() { return properties.getValue(LAST_MIDI_IN_KEY); }
+    String getLastMidiOut() { return properties.getValue(LAST_MIDI_OUT_KEY); }
+
+  private:
+    static PropertiesFile::Options getOptions();
+    static String getKey(const String& midiInName, const String& midiOutName) { return "synth:" + midiInName + "|" + midiOutName; }
+
+    const String LAST_MIDI_IN_KEY = "lastMidiIn";
+    const String LAST_MIDI_OUT_KEY = "lastMidiOut";
+
+    PropertiesFile properties;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ConnectionCache)
+};
@@ -0,0 +1,122 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#include <JuceHeader.h>
+
+using namespace juce;
+
+// Measures the control server with a local client, while SideQick is running with its control server enabled:
+//     SideQickControlBench [port] [number of requests] [request]
+// The client authenticates with the token the server wrote to the SideQick settings folder.
+// The requests are first sent one at a time to measure the latency, then with several in flight to measure the throughput.
+// PING measures the server alone, GET and SET go through the MIDI processing queue as well.
+
+namespace {
+const int PIPELINE_DEPTH = 32;
+
+class LineClient {
+  public:
+    bool connect(int port) { return socket.connect("127.0.0.1", port, 2000); }
+
+    bool send(const String& line) {
+        const auto data = line + "\n";
+        return socket.write(data.toRawUTF8(), static_cast<int>(data.getNumBytesAsUTF8())) > 0;
+    }
+
+    bool readLine(String& line) {
+        for (;;) {
+            const auto lineEnd = pendingData.indexOfChar('\n');
+            if (lineEnd >= 0) {
+                line = pendingData.substring(0, lineEnd);
+                pendingData = pendingData.substring(lineEnd + 1);
+                return true;
+            }
+            char buffer[4096];
+            const auto nbOfBytesRead = socket.read(buffer, sizeof(buffer), false);
+            if (nbOfBytesRead <= 0)
+                return false;
+            pendingData += String::fromUTF8(buffer, nbOfBytesRead);
+        }
+    }
+
+  private:
+    StreamingSocket socket;
+    String pendingData;
+};
+
+double getPercentile(const Array<double>& sortedValues, double percentile) {
+    return sortedValues[jmin(sortedValues.size() - 1, static_cast<int>(percentile / 100.0 * sortedValues.size()))];
+}
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const int port = argc > 1 ? String(argv[1]).getIntValue() : 47810;
+    const int nbOfRequests = argc > 2 ? jmax(1, String(argv[2]).getIntValue()) : 1000;
+    const String request = argc > 3 ? String(argv[3]) : String("PING");
+
+    LineClient client;
+    if (!client.connect(port)) {
+        std::cerr << "Could not connect to the control server on port " << port << std::endl;
+        return 1;
+    }
+
+    // Same file as ControlServer::getTokenFile()
+    const auto tokenFile = File::getSpecialLocation(File::userApplicationDataDirectory).getChildFile("SideQick").getChildFile("control-token.txt");
+    String answer;
+    if (!client.send("AUTH " + tokenFile.loadFileAsString().trim()) || !client.readLine(answer) || answer != "OK") {
+        std::cerr << "The server refused the token in " << tokenFile.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    // Latency, one request at a time
+    Array<double> latencies;
+    for (int requestIdx = 0; requestIdx < nbOfRequests; requestIdx++) {
+        const auto sendTime = Time::getMillisecondCounterHiRes();
+        if (!client.send(request) || !client.readLine(answer)) {
+            std::cerr << "The server closed the connection" << std::endl;
+            return 1;
+        }
+        latencies.add(Time::getMillisecondCounterHiRes() - sendTime);
+        if (requestIdx == 0 && !answer.startsWith("OK")) {
+            std::cerr << "The server answered " << answer << std::endl;
+            return 1;
+        }
+    }
+    latencies.sort();
+
+    double totalLatency = 0.0;
+    for (auto latency : latencies)
+        totalLatency += latency;
+
+    // Throughput, with a window of tagged requests in flight so neither side blocks on a full socket buffer
+    const auto startTime = Time::getMillisecondCounterHiRes();
+    int nbOfSent = 0;
+    int nbOfAnswered = 0;
+    while (nbOfAnswered < nbOfRequests) {
+        while (nbOfSent < nbOfRequests && nbOfSent - nbOfAnswered < PIPELINE_DEPTH)
+            client.send("#" + String(nbOfSent++) + " " + request);
+        if (!client.readLine(answer)) {
+            std::cerr << "The server closed the connection" << std::endl;
+            return 1;
+        }
+        nbOfAnswered++;
+    }
+    const auto totalTime = Time::getMillisecondCounterHiRes() - startTime;
+
+    std::cout << nbOfRequests << " x " << request << std::endl;
+    std::cout << "Latency (ms): mean " << String(totalLatency / nbOfRequests, 3) << ", median " << String(getPercentile(latencies, 50.0), 3) << ", p99 "
+              << String(getPercentile(latencies, 99.0), 3) << ", max " << String(latencies.getLast(), 3) << std::endl;
+    std::cout << "Throughput with " << PIPELINE_DEPTH << " requests in flight: " << String(nbOfRequests * 1000.0 / totalTime, 0) << " requests/s" << std::endl;
+    return 0;
+}
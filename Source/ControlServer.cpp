@@ -0,0 +1,322 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#include "ControlServer.h"
+#include "ProgramParser.h"
+
+using namespace juce;
+
+const StringArray ControlServer::STATUS_NAMES = {"CONNECTED", "DISCONNECTED", "SYSEX_DISABLED", "MODIFYING_PROGRAM", "REFRESHING"};
+const StringArray ControlServer::COMMANDS = {"PING", "STATUS", "CONNECT", "GET", "SET", "BATCH", "PUT", "BANK"};
+
+struct ControlServer::Client {
+    std::unique_ptr<StreamingSocket> socket;
+    CriticalSection writeLock;
+
+    // The answers come from the request queue while the connection thread reads, so the writes are serialised
+    void send(const String& line) {
+        const ScopedLock sl(writeLock);
+        const auto data = line + "\n";
+        if (socket->isConnected())
+            socket->write(data.toRawUTF8(), static_cast<int>(data.getNumBytesAsUTF8()));
+    }
+};
+
+// Reads the requests of one client, one line at a time
+class ControlServer::Connection : public Thread {
+  public:
+    Connection(ControlServer& owner, std::unique_ptr<StreamingSocket> socket) : Thread("SideQick control client"), server(owner), client(std::make_shared<Client>()) {
+        client->socket = std::move(socket);
+        startThread();
+    }
+
+    ~Connection() override {
+        stopThread(1000);
+        const ScopedLock sl(client->writeLock);
+        client->socket->close();
+    }
+
+    void run() override {
+        char buffer[4096];
+        String pendingData;
+        bool authenticated = false;
+
+        while (!threadShouldExit()) {
+            const auto ready = client->socket->waitUntilReady(true, 100);
+            if (ready < 0)
+                break;
+            if (ready == 0)
+                continue;
+
+            const auto nbOfBytesRead = client->socket->read(buffer, sizeof(buffer), false);
+            // Zero bytes on a readable socket means the client hung up
+            if (nbOfBytesRead <= 0)
+                break;
+            pendingData += String::fromUTF8(buffer, nbOfBytesRead);
+
+            for (auto lineEnd = pendingData.indexOfChar('\n'); lineEnd >= 0; lineEnd = pendingData.indexOfChar('\n')) {
+                const auto line = pendingData.substring(0, lineEnd).trim();
+                pendingData = pendingData.substring(lineEnd + 1);
+                if (line.isEmpty())
+                    continue;
+
+                // Anything unexpected ends the connection, the rest of what the client sent is never run
+                if (!authenticated) {
+                    if (!server.isAuthenticationRequest(line)) {
+                        client->send("ERR Expected AUTH with the token of " + getTokenFile().getFullPathName());
+                        return;
+                    }
+                    authenticated = true;
+                    client->send("OK");
+                } else if (isKnownRequest(line))
+                    server.queueRequest(client, line);
+                else {
+                    client->send("ERR Unknown request, closing the connection");
+                    return;
+                }
+            }
+        }
+    }
+
+  private:
+    ControlServer& server;
+    std::shared_ptr<Client> client;
+};
+
+ControlServer::ControlServer(MidiSysexProcessor& midiProcessor) : Thread("SideQick control server"), processor(midiProcessor) {}
+
+ControlServer::~ControlServer() { stop(); }
+
+bool ControlServer::start(int port) {
+    stop();
+
+    uint8_t tokenBytes[16];
+    Random random;
+    random.setSeedRandomly();
+    random.fillBitsRandomly(tokenBytes, sizeof(tokenBytes));
+    token = String::toHexString(tokenBytes, sizeof(tokenBytes), 0);
+    if (!getTokenFile().getParentDirectory().createDirectory() || !getTokenFile().replaceWithText(token))
+        return false;
+
+    // Only local clients, which still have to show the token
+    if (!listener.createListener(port, "127.0.0.1"))
+        return false;
+    startThread();
+    return true;
+}
+
+void ControlServer::stop() {
+    signalThreadShouldExit();
+    listener.close();
+    stopThread(1000);
+
+    const ScopedLock sl(connectionsLock);
+    connections.clear();
+}
+
+int ControlServer::getNbOfClients() const {
+    const ScopedLock sl(connectionsLock);
+    int nbOfClients = 0;
+    for (auto* connection : connections)
+        nbOfClients += connection->isThreadRunning() ? 1 : 0;
+    return nbOfClients;
+}
+
+void ControlServer::run() {
+    while (!threadShouldExit()) {
+        if (listener.waitUntilReady(true, 200) == 1) {
+            if (auto* socket = listener.waitForNextConnection()) {
+                const ScopedLock connectionsSl(connectionsLock);
+                connections.add(new Connection(*this, std::unique_ptr<StreamingSocket>(socket)));
+            }
+        }
+
+        // The clients that hung up are cleaned up from here
+        const ScopedLock sl(connectionsLock);
+        for (int connectionIdx = connections.size(); --connectionIdx >= 0;)
+            if (!connections[connectionIdx]->isThreadRunning())
+                connections.remove(connectionIdx);
+    }
+}
+
+File ControlServer::getTokenFile() {
+    return File::getSpecialLocation(File::userApplicationDataDirectory).getChildFile("SideQick").getChildFile("control-token.txt");
+}
+
+bool ControlServer::isAuthenticationRequest(const String& line) const {
+    const auto tokens = StringArray::fromTokens(line, true);
+    return tokens.size() == 2 && tokens[0] == "AUTH" && tokens[1] == token;
+}
+
+bool ControlServer::isKnownRequest(const String& line) {
+    auto tokens = StringArray::fromTokens(line, true);
+    if (tokens[0].startsWithChar('#'))
+        tokens.remove(0);
+    // "GET / HTTP/1.1" starts like one of ours
+    return COMMANDS.contains(tokens[0].toUpperCase()) && !tokens[tokens.size() - 1].startsWithIgnoreCase("HTTP/");
+}
+
+void ControlServer::queueRequest(std::shared_ptr<Client> client, const String& line) {
+    requestQueue.addJob([this, client, line] {
+        auto tokens = StringArray::fromTokens(line, true);
+        String tag;
+        if (tokens[0].startsWithChar('#')) {
+            tag = tokens[0] + " ";
+            tokens.remove(0);
+        }
+        client->send(tag + handleRequest(tokens));
+    });
+}
+
+String ControlServer::getStatusAnswer() const {
+    const auto model = processor.synthState.getModel();
+    const auto modelName = MODEL_NAMES[model == UNCHANGED ? UNKNOWN : model].toUpperCase();
+    return "OK " + STATUS_NAMES[processor.synthState.getStatus()] + " " + modelName + " " + processor.getChannel();
+}
+
+String ControlServer::handleRequest(const StringArray& tokens) {
+    const auto command = tokens[0].toUpperCase();
+
+    if (command == "PING")
+        return "OK PONG";
+
+    if (command == "STATUS")
+        return getStatusAnswer();
+
+    if (command == "CONNECT") {
+        if (!onConnectRequested)
+            return "ERR Connecting is not available";
+        // Shared, in case the connection finishes after the timeout
+        auto connected = std::make_shared<WaitableEvent>();
+        onConnectRequested([connected] { connected->signal(); });
+        if (!connected->wait(CONNECT_TIMEOUT))
+            return "ERR The connection did not finish in time";
+        return getStatusAnswer();
+    }
+
+    if (command == "GET") {
+        const auto source = tokens[1].equalsIgnoreCase("SYNTH") ? MidiSysexProcessor::FROM_SYNTH : MidiSysexProcessor::FROM_CACHE;
+        auto program = processor.getProgramToEdit(source);
+        if (program.getSysExDataSize() != MidiSysexProcessor::SQ_ESQ_PROG_SIZE)
+            return "ERR The synth did not send its program";
+        return "OK " + String::toHexString(program.getSysExData(), MidiSysexProcessor::SQ_ESQ_PROG_SIZE, 0);
+    }
+
+    if (command == "SET") {
+        if (tokens.size() != 3)
+            return "ERR Usage: SET <parameter> <value>";
+        return editProgram(StringArray(tokens[1] + "=" + tokens[2]));
+    }
+
+    if (command == "BATCH") {
+        if (tokens.size() < 2)
+            return "ERR Usage: BATCH <parameter>=<value> ...";
+        StringArray assignments(tokens);
+        assignments.remove(0);
+        return editProgram(assignments);
+    }
+
+    if (command == "PUT" || command == "BANK") {
+        MemoryBlock data;
+        data.loadFromHexString(tokens[1]);
+        const auto* bytes = static_cast<const uint8_t*>(data.getData());
+        const auto size = static_cast<int>(data.getSize());
+
+        if (command == "PUT") {
+            if (size != MidiSysexProcessor::SQ_ESQ_PROG_SIZE || bytes[0] != 0x0F || bytes[1] != 0x02 || bytes[3] != 0x01)
+                return "ERR Not an SQ-80/ESQ-1 program";
+            HeapBlock<uint8_t> progData(MidiSysexProcessor::SQ_ESQ_PROG_SIZE);
+            memcpy(progData.getData(), bytes, MidiSysexProcessor::SQ_ESQ_PROG_SIZE);
+            // The program goes to the channel of the synth we're connected to
+            progData[2] = static_cast<uint8_t>(processor.getChannel().getIntValue() - 1);
+            processor.sendProgramDump(progData);
+            if (onProgramChanged)
+                onProgramChanged(DeviceResponse(CONNECTED, MidiMessage::createSysExMessage(progData, MidiSysexProcessor::SQ_ESQ_PROG_SIZE)));
+            return "OK";
+        }
+
+        if (!ProgramParser::isBankDump(bytes, size))
+            return "ERR Not an SQ-80/ESQ-1 bank";
+        HeapBlock<uint8_t> bankData(ProgramParser::BANK_DATA_SIZE);
+        memcpy(bankData.getData(), bytes, ProgramParser::BANK_DATA_SIZE);
+        bankData[2] = static_cast<uint8_t>(processor.getChannel().getIntValue() - 1);
+        const auto upload = processor.uploadBank(bankData);
+        if (!upload.confirmed)
+            return "ERR The synth did not answer after the bank";
+        return "OK " + String(upload.durationMs, 0) + " " + String(upload.bytesPerSecond, 0);
+    }
+
+    return "ERR Unknown command " + tokens[0].quoted();
+}
+
+String ControlServer::editProgram(const StringArray& assignments) {
+    // Everything is checked before the edit, so a bad batch doesn't send half of its changes
+    StringArray parameters;
+    Array<int> values;
+    HeapBlock<uint8_t> scratch(MidiSysexProcessor::SQ_ESQ_PROG_SIZE, true);
+
+    for (auto& assignment : assignments) {
+        const auto parameter = assignment.upToFirstOccurrenceOf("=", false, false).toLowerCase();
+        const auto value = assignment.fromFirstOccurrenceOf("=", false, false);
+        if (!assignment.containsChar('=') || !value.containsOnly("-0123456789") || !applyParameter(scratch, parameter, value.getIntValue()))
+            return "ERR Invalid edit " + assignment.quoted();
+        if (parameter.startsWith("wave") && !processor.synthState.canPlayWave(value.getIntValue()))
+            return "ERR The synth can't play hidden waves";
+        parameters.add(parameter);
+        values.add(value.getIntValue());
+    }
+
+    auto response = processor.editProgram(
+        [&parameters, &values](uint8_t* progData) {
+            for (int paramIdx = 0; paramIdx < parameters.size(); paramIdx++)
+                applyParameter(progData, parameters[paramIdx], values[paramIdx]);
+        },
+        MidiSysexProcessor::FROM_CACHE);
+
+    if (onProgramChanged)
+        onProgramChanged(response);
+    return response.status == CONNECTED ? String("OK") : String("ERR The synth did not send its program");
+}
+
+bool ControlServer::applyParameter(uint8_t* progData, const String& parameter, int value) {
+    const int osc = static_cast<int>(parameter.getLastCharacter()) - '1';
+    const auto name = parameter.dropLastCharacters(1);
+
+    if (parameter.startsWith("nibble")) {
+        const auto nibbleIdx = parameter.substring(6).getIntValue();
+        if (!parameter.substring(6).containsOnly("0123456789") || !isPositiveAndBelow(nibbleIdx - ProgramParser::PROG_HEADER_SIZE, ProgramParser::PROG_NB_OF_NIBBLES) ||
+            !isPositiveAndBelow(value, 16))
+            return false;
+        progData[nibbleIdx] = static_cast<uint8_t>(value);
+        return true;
+    }
+
+    if (parameter == "selfosc") {
+        ProgramParser::setSelfOscillation(progData, value != 0);
+        return true;
+    }
+
+    if (!isPositiveAndBelow(osc, 3))
+        return false;
+
+    if (name == "wave" && isPositiveAndBelow(value, 256))
+        ProgramParser::setNibblePair(progData, ProgramParser::WAVE[osc], value);
+    else if (name == "oct" && value >= -3 && value <= 7)
+        ProgramParser::setOctave(progData, osc, value);
+    else if (name == "lf")
+        ProgramParser::setLowFrequencyRange(progData, osc, value != 0);
+    else
+        return false;
+    return true;
+}
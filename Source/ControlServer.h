@@ -0,0 +1,91 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#pragma once
+
+#include "DeviceResponse.h"
+#include "MidiSysexProcessor.h"
+#include <JuceHeader.h>
+#include <memory>
+
+using namespace juce;
+
+// Lets other tools on the same computer drive the edits through a TCP socket on localhost. The protocol is one request per line
+// and one answer per line, so it can be used from a script or by hand with netcat. A request may start with a #tag, which is
+// repeated at the start of its answer so clients can send several requests without waiting for each answer.
+// The first line of a client must be AUTH with the token written to getTokenFile() when the server starts, so only the programs
+// able to read the user's files can drive the synth, and not for example a web page posting to the port. The connection is closed
+// on a wrong token, and on any line that isn't one of the commands below, such as the start of an HTTP request.
+//     AUTH <token>                          OK
+//     PING                                  OK PONG
+//     STATUS                                OK <status> <model> <channel>
+//     CONNECT                               connects again like the UI does, answers like STATUS
+//     GET [SYNTH]                           OK <program as hex>, from the synth instead of the last known program with SYNTH
+//     SET <parameter> <value>               one edit, sent as a single program
+//     BATCH <parameter>=<value> ...         several edits sent as a single program
+//     PUT <program as hex>                  sends a whole program
+//     BANK <bank as hex>                    writes an all-programs dump into the synth's memory, OK <duration in ms> <bytes/s>
+// The parameters are wave1-3 (0-255), oct1-3 (-3 to +7), lf1-3 and selfosc (0 or 1), and nibble<idx> for any other program nibble.
+// Errors are answered with ERR and a message. The requests of every client go through a single queue, in the order they arrive.
+class ControlServer : private Thread {
+  public:
+    static const int DEFAULT_PORT = 47810;
+
+    ControlServer(MidiSysexProcessor& processor);
+    ~ControlServer() override;
+
+    bool start(int port = DEFAULT_PORT);
+    void stop();
+    bool isRunning() const { return isThreadRunning(); }
+    int getPort() const { return listener.getPort(); }
+    int getNbOfClients() const;
+    // Holds the token of the running server, a new one is written every time it starts
+    static File getTokenFile();
+
+    // Called from the request queue when a request changed the program
+    std::function<void(const DeviceResponse& response)> onProgramChanged;
+    // Called from the request queue for CONNECT. The connection goes through the UI, so the known synths and the status shown
+    // stay in step with it, and onFinished must be called once the new status is published.
+    std::function<void(std::function<void()> onFinished)> onConnectRequested;
+
+  private:
+    struct Client;
+    class Connection;
+
+    void run() override;
+    bool isAuthenticationRequest(const String& line) const;
+    static bool isKnownRequest(const String& line);
+    void queueRequest(std::shared_ptr<Client> client, const String& line);
+    String handleRequest(const StringArray& tokens);
+    String getStatusAnswer() const;
+    String editProgram(const StringArray& assignments);
+    static bool applyParameter(uint8_t* progData, const String& parameter, int value);
+
+    MidiSysexProcessor& processor;
+    StreamingSocket listener;
+    OwnedArray<Connection> connections;
+    CriticalSection connectionsLock;
+    // Set before the server thread starts, and only read by the connections
+    String token;
+
+    static const StringArray STATUS_NAMES;
+    static const StringArray COMMANDS;
+    // A full DeviceInquiry, scanning every channel for the older ESQ-1s, takes less than this
+    static const int CONNECT_TIMEOUT = 10000;
+
+    // Declared last so it's deleted first, while the connections it answers to are already closed
+    ThreadPool requestQueue{1};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ControlServer)
+};
@@ -13,7 +13,7 @@
  */
 
 #pragma once
-#include <JuceHeader.h>
+#include <juce_audio_basics/juce_audio_basics.h>
 
 using namespace juce;
 
@@ -21,6 +21,8 @@ enum Status { CONNECTED, DISCONNECTED, SYSEX_DISABLED, MODIFYING_PROGRAM, REFRES
 const StringArray STATUS_MESSAGES = {"Connected", "Di5connected", "5y5ex    Di5abled", "Modifying    Program    .    .    .", "Refre5hing    .    .    ."};
 enum SynthModel { SQ80, ESQ1, ESQM, SQ80M, UNKNOWN, UNCHANGED };
 const StringArray SYNTH_MODELS = {"5Q-80", "E5Q-1", "E5Q-M", "5Q80M", "Unknown", "Unchanged"};
+// Same models in plain text, for the menus, the files and the remote control
+const StringArray MODEL_NAMES = {"SQ-80", "ESQ-1", "ESQ-M", "SQ-80M", "Unknown", "Unchanged"};
 const unsigned int NB_OF_WAVES[4] = {75, 32, 32, 75};
 
 const int SQ_ESQ_FAMILY_ID = 0x02;
@@ -41,21 +43,24 @@ enum VersionNumber { MINOR, MAJOR };
 
 class DeviceResponse {
   public:
-    String status = STATUS_MESSAGES[DISCONNECTED];
+    Status status = DISCONNECTED;
     unsigned int model = UNKNOWN;
     String osVersion[2];
     bool supportsHiddenWaves = true;
 
     MidiMessage currentProgram;
+    // Empty for the ESQ-1s that don't answer the DeviceInquiry request
+    MidiMessage deviceIdMessage;
 
     // This constructor should be called when we set the status to Refreshing or Disconnected
-    DeviceResponse(String status, MidiMessage currentProgram) {
+    DeviceResponse(Status status, MidiMessage currentProgram) {
         this->status = status;
         this->currentProgram = currentProgram;
         this->model = UNCHANGED;
     }
     // This constructor should be called when we set the status to Connected or Sysex Disabled
-    DeviceResponse(String status, MidiMessage deviceIdMessage, MidiMessage currentProgram) : DeviceResponse(status, currentProgram) {
+    DeviceResponse(Status status, MidiMessage deviceIdMessage, MidiMessage currentProgram) : DeviceResponse(status, currentProgram) {
+        this->deviceIdMessage = deviceIdMessage;
         const uint8_t* deviceIdData = deviceIdMessage.getSysExData();
         // Check if a supported model responded to the DeviceInquiry request
         if (deviceIdMessage.getSysExDataSize() == DEVICE_ID_SIZE) {
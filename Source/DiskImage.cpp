@@ -0,0 +1,137 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#include "DiskImage.h"
+#include "ProgramLibrary.h"
+#include "ProgramParser.h"
+
+using namespace juce;
+
+const String DiskImage::FILE_PATTERNS = "*.img;*.ima;*.dsk";
+
+DiskImage::DiskImage(const File& imageFile) : file(imageFile) {
+    if (file.getSize() <= 0 || file.getSize() > MAX_IMAGE_SIZE)
+        return;
+
+    mappedImage = std::make_unique<MemoryMappedFile>(file, MemoryMappedFile::readOnly);
+    if (isOpen() && !readFatDirectory()) {
+        entries.clear();
+        defragmentedFiles.clear();
+        mappedImage.reset();
+    }
+}
+
+bool DiskImage::readFatDirectory() {
+    const auto* image = getImageData();
+    const auto imageSize = getImageSize();
+    if (imageSize < 512)
+        return false;
+
+    // The BIOS parameter block of the boot sector
+    const auto readWord = [image](int offset) { return static_cast<int>(ByteOrder::littleEndianShort(image + offset)); };
+    const auto bytesPerSector = readWord(11);
+    const auto sectorsPerCluster = static_cast<int>(image[13]);
+    const auto nbOfReservedSectors = readWord(14);
+    const auto nbOfFats = static_cast<int>(image[16]);
+    const auto nbOfRootEntries = readWord(17);
+    const auto nbOfSectors = readWord(19);
+    const auto sectorsPerFat = readWord(22);
+    if (bytesPerSector != 512 || sectorsPerCluster == 0 || nbOfFats == 0 || nbOfFats > 2 || nbOfRootEntries == 0 || sectorsPerFat == 0 ||
+        nbOfSectors * bytesPerSector > imageSize)
+        return false;
+
+    const auto fatStart = nbOfReservedSectors * bytesPerSector;
+    const auto rootStart = fatStart + nbOfFats * sectorsPerFat * bytesPerSector;
+    const auto dataStart = rootStart + nbOfRootEntries * 32;
+    const auto clusterSize = sectorsPerCluster * bytesPerSector;
+    if (dataStart > imageSize)
+        return false;
+
+    // FAT12 packs two 12-bit entries in three bytes
+    const auto getNextCluster = [&](int cluster) {
+        const auto entry = readWord(fatStart + cluster * 3 / 2);
+        return cluster % 2 == 0 ? entry & 0xFFF : entry >> 4;
+    };
+    // Clusters past the end of the image or of the FAT are treated as the end of a file
+    const auto nbOfClusters = jmin((imageSize - dataStart) / clusterSize, (sectorsPerFat * bytesPerSector - 1) * 2 / 3 - 2);
+
+    // The librarians kept their files in the root directory, the subdirectories aren't read
+    for (int entryIdx = 0; entryIdx < nbOfRootEntries; entryIdx++) {
+        const auto* dirEntry = image + rootStart + entryIdx * 32;
+        if (dirEntry[0] == 0x00)
+            break;
+        // Deleted files, volume labels (which also marks the long file names) and subdirectories
+        if (dirEntry[0] == 0xE5 || (dirEntry[11] & 0x18) != 0)
+            continue;
+
+        const auto name = String(reinterpret_cast<const char*>(dirEntry), 8).trimEnd();
+        const auto extension = String(reinterpret_cast<const char*>(dirEntry) + 8, 3).trimEnd();
+        const auto fileSize = static_cast<int>(ByteOrder::littleEndianInt(dirEntry + 28));
+        const auto firstCluster = static_cast<int>(ByteOrder::littleEndianShort(dirEntry + 26));
+        if (fileSize <= 0 || firstCluster < 2 || firstCluster - 2 >= nbOfClusters)
+            continue;
+
+        Entry entry{extension.isEmpty() ? name : name + "." + extension, image + dataStart + (firstCluster - 2) * clusterSize, fileSize};
+
+        // Most files are in consecutive clusters and are read in place, the others are put back together
+        const auto nbOfFileClusters = (fileSize + clusterSize - 1) / clusterSize;
+        Array<int> clusters{firstCluster};
+        bool contiguous = true;
+        while (clusters.size() < nbOfFileClusters) {
+            const auto nextCluster = getNextCluster(clusters.getLast());
+            if (nextCluster < 2 || nextCluster - 2 >= nbOfClusters)
+                break;
+            contiguous = contiguous && nextCluster == clusters.getLast() + 1;
+            clusters.add(nextCluster);
+        }
+        if (clusters.size() < nbOfFileClusters)
+            continue;
+
+        if (!contiguous) {
+            auto* fileData = defragmentedFiles.add(new MemoryBlock());
+            for (auto cluster : clusters)
+                fileData->append(image + dataStart + (cluster - 2) * clusterSize, static_cast<size_t>(clusterSize));
+            entry.data = static_cast<const uint8_t*>(fileData->getData());
+        } else if (entry.data + fileSize > image + imageSize)
+            continue;
+
+        entries.add(entry);
+    }
+    return true;
+}
+
+void DiskImage::forEachDump(const std::function<void(const Entry& entry, const uint8_t* sysexData, int size)>& callback) const {
+    for (auto& entry : entries)
+        ProgramLibrary::forEachDumpInData(entry.data, entry.size, [&](const uint8_t* sysexData, int size) { callback(entry, sysexData, size); });
+}
+
+int DiskImage::extractDumps(const File& folder) const {
+    if (!folder.createDirectory())
+        return 0;
+
+    int nbOfFilesWritten = 0;
+    int dumpIdx = 0;
+    forEachDump([&](const Entry& entry, const uint8_t* sysexData, int size) {
+        const auto suffix = ProgramParser::isBankDump(sysexData, size) ? " bank " : " program ";
+        auto outputFile = folder.getChildFile(File::createLegalFileName(entry.name + suffix + String(++dumpIdx) + ".syx")).getNonexistentSibling();
+
+        MemoryBlock dump;
+        dump.append("\xF0", 1);
+        dump.append(sysexData, static_cast<size_t>(size));
+        dump.append("\xF7", 1);
+        if (outputFile.replaceWithData(dump.getData(), dump.getSize()))
+            nbOfFilesWritten++;
+    });
+    return nbOfFilesWritten;
+}
@@ -0,0 +1,64 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <functional>
+
+using namespace juce;
+
+// Raw images of 3.5" disks written by computer librarians on a FAT12 file system, memory-mapped so the programs are read in
+// place from the files of the root directory. Only these librarian disks are read for now.
+// TODO: Read the disks formatted by the SQ-80 itself. They aren't FAT12 and store the programs packed instead of as SysEx,
+// so their directory and program layout has to be worked out first. Until then they don't open.
+class DiskImage {
+  public:
+    static const String FILE_PATTERNS;
+    static bool isDiskImage(const File& file) { return file.hasFileExtension("img;ima;dsk"); }
+
+    DiskImage(const File& imageFile);
+
+    // False if the file isn't a FAT12 disk image
+    bool isOpen() const { return mappedImage != nullptr && mappedImage->getData() != nullptr; }
+
+    struct Entry {
+        String name;
+        // Points into the mapped image, or to a copy for the files whose clusters aren't contiguous
+        const uint8_t* data = nullptr;
+        int size = 0;
+    };
+    // The files of the root directory
+    const Array<Entry>& getEntries() const { return entries; }
+
+    // Calls back with the SysEx data of every program and bank dump on the disk, without their F0 and F7
+    void forEachDump(const std::function<void(const Entry& entry, const uint8_t* sysexData, int size)>& callback) const;
+    // Writes every dump to its own .syx file in the folder. Returns the number of files written.
+    int extractDumps(const File& folder) const;
+
+  private:
+    bool readFatDirectory();
+    const uint8_t* getImageData() const { return static_cast<const uint8_t*>(mappedImage->getData()); }
+    int getImageSize() const { return static_cast<int>(mappedImage->getSize()); }
+
+    const File file;
+    std::unique_ptr<MemoryMappedFile> mappedImage;
+    Array<Entry> entries;
+    OwnedArray<MemoryBlock> defragmentedFiles;
+
+    // A 3.5" HD disk, anything bigger isn't a floppy image
+    static const int MAX_IMAGE_SIZE = 1474560;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DiskImage)
+};
@@ -67,11 +67,7 @@ DisplayLookAndFeel::DisplayLookAndFeel() {
     setColour(Label::textColourId, displayColour);
 }
 
-Typeface::Ptr DisplayLookAndFeel::getCustomTypeface() {
-    if (!customTypeface)
-        customTypeface = Typeface::createSystemTypefaceFor(BinaryData::DSEG14ClassicItalic_ttf, BinaryData::DSEG14ClassicItalic_ttfSize);
-    return customTypeface;
-}
+Typeface::Ptr DisplayLookAndFeel::getCustomTypeface() { return customTypeface->typeface; }
 
 Font DisplayLookAndFeel::getLabelFont(Label& label) { return Font(getCustomTypeface()); }
 
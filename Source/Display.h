@@ -34,7 +34,12 @@ class DisplayLookAndFeel : public juce::LookAndFeel_V4 {
 
   private:
     const Colour DISPLAY_BACK_COLOUR = Colour::fromRGB(6, 0, 10);
-    Typeface::Ptr customTypeface;
+
+    // The DSEG14 typeface is created once and shared by every DisplayLookAndFeel, until the last one is deleted
+    struct SharedTypeface {
+        Typeface::Ptr typeface = Typeface::createSystemTypefaceFor(BinaryData::DSEG14ClassicItalic_ttf, BinaryData::DSEG14ClassicItalic_ttfSize);
+    };
+    SharedResourcePointer<SharedTypeface> customTypeface;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DisplayLookAndFeel)
 };
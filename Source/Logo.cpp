@@ -18,25 +18,48 @@
 using namespace juce;
 
 Logo::Logo() {
-    // Load the SVG from the binary data
-    auto svgData = BinaryData::logo_svg;
-    auto svgSize = BinaryData::logo_svgSize;
+    // Parsing the SVG is the slow part, so it's done in the background. The Drawable itself is built on the message thread.
+    juce::Thread::launch([safeThis = SafePointer<Logo>(this)] {
+        std::shared_ptr<juce::XmlElement> svg = juce::parseXML(juce::String::createStringFromData(BinaryData::logo_svg, BinaryData::logo_svgSize));
 
-    // Create a Drawable from the SVG data
-    drawable = juce::Drawable::createFromImageData(svgData, svgSize);
+        juce::MessageManager::callAsync([safeThis, svg] {
+            if (safeThis != nullptr)
+                safeThis->setDrawable(svg != nullptr ? juce::Drawable::createFromSVG(*svg) : nullptr);
+        });
+    });
+}
+
+void Logo::setDrawable(std::unique_ptr<juce::Drawable> newDrawable) {
+    drawable = std::move(newDrawable);
+    if (drawable != nullptr)
+        drawable->replaceColour(juce::Colours::white, juce::Colours::lightgrey);
+
+    cachedImage = {};
+    repaint();
+
+    if (onLoaded)
+        onLoaded();
 }
 
 void Logo::paint(juce::Graphics& g) {
     if (drawable != nullptr) {
         // Get the area to draw within
         auto bounds = getLocalBounds().toFloat();
+        auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+        auto imageWidth = juce::roundToInt(bounds.getWidth() * scale);
+        auto imageHeight = juce::roundToInt(bounds.getHeight() * scale);
+
+        if (imageWidth <= 0 || imageHeight <= 0)
+            return;
 
-        // Draw the SVG
-        drawable->drawWithin(g, bounds, juce::RectanglePlacement::xLeft, 1.0f);
+        if (cachedImage.getWidth() != imageWidth || cachedImage.getHeight() != imageHeight) {
+            cachedImage = juce::Image(juce::Image::ARGB, imageWidth, imageHeight, true);
+            juce::Graphics imageGraphics(cachedImage);
 
-        if (drawable != nullptr) {
-            // Replace the color in the SVG (for example, replace black with red)
-            drawable->replaceColour(juce::Colours::white, juce::Colours::lightgrey);
+            // Draw the SVG
+            drawable->drawWithin(imageGraphics, cachedImage.getBounds().toFloat(), juce::RectanglePlacement::xLeft, 1.0f);
         }
+
+        g.drawImage(cachedImage, bounds);
     }
 }
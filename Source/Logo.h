@@ -23,8 +23,15 @@ class Logo : public juce::Component {
     Logo();
     void paint(juce::Graphics& g) override;
 
+    // Called on the message thread once the SVG has been parsed in the background
+    std::function<void()> onLoaded;
+
   private:
+    void setDrawable(std::unique_ptr<juce::Drawable> newDrawable);
+
     std::unique_ptr<juce::Drawable> drawable;
+    // The SVG is only rasterized again when the size or the display scale changes
+    juce::Image cachedImage;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Logo)
 };
@@ -13,6 +13,7 @@
  */
 
 #include "MainComponent.h"
+#include "StartupProfiler.h"
 #include <JuceHeader.h>
 
 #include <csignal>
@@ -50,6 +51,7 @@ class SideQickApplication : public juce::JUCEApplication {
     //==============================================================================
     void initialise(const juce::String& commandLine) override {
         registerSignalHandlers();
+        StartupProfiler::getInstance().begin();
         mainWindow.reset(new MainWindow(getApplicationName()));
     }
 
@@ -79,6 +81,7 @@ class SideQickApplication : public juce::JUCEApplication {
             centreWithSize(getWidth(), getHeight());
 
             setVisible(true);
+            StartupProfiler::getInstance().mark("window shown");
         }
 
         void closeButtonPressed() override { JUCEApplication::getInstance()->systemRequestedQuit(); }
@@ -18,26 +18,48 @@
 #include "MidiSysexProcessor.h"
 #include "PannelButton.h"
 #include "ProgramParser.h"
+#include "StartupProfiler.h"
 #include <functional>
+#include <map>
 
 using namespace juce;
 
-PlasticTexture::PlasticTexture(const Image& textureImage) : textureImage(textureImage) { setInterceptsMouseClicks(false, true); }
+PlasticTexture::PlasticTexture(const Image& textureImage) : sourceImage(textureImage) { setInterceptsMouseClicks(false, true); }
+
+void PlasticTexture::setSourceImage(const Image& textureImage) {
+    sourceImage = textureImage;
+    resized();
+    repaint();
+}
 
 void PlasticTexture::paint(Graphics& g) {
-    if (textureImage.isValid()) {
-        g.setOpacity(0.13f);
-        g.drawImage(textureImage, getLocalBounds().toFloat());
-    }
+    if (textureImage.isValid())
+        g.drawImageAt(textureImage, 0, 0);
 }
 void PlasticTexture::resized() {
-    if (textureImage.isValid()) {
-        textureImage = textureImage.rescaled(getWidth(), getHeight());
+    if (sourceImage.isValid() && getWidth() > 0 && getHeight() > 0) {
+        textureImage = sourceImage.rescaled(getWidth(), getHeight()).convertedToFormat(Image::ARGB);
+        textureImage.multiplyAllAlphas(TEXTURE_OPACITY);
+    }
+}
+
+// The waveform options only depend on the number of normal waves of the model, so they are built once per model
+// family and shared by the three oscillator menus instead of being rebuilt on every connection.
+static const PopupMenu& getWaveMenuOptions(unsigned int nbOfWaves) {
+    static std::map<unsigned int, PopupMenu> waveMenuOptions;
+
+    auto& options = waveMenuOptions[nbOfWaves];
+    if (options.getNumItems() == 0) {
+        options.addItem(1, "WAV0    to    WAV" + String(nbOfWaves - 1));
+        for (unsigned int w = nbOfWaves; w < 256; w++)
+            options.addItem(static_cast<int>(w - nbOfWaves) + 2, "WAV" + String(w));
     }
+    return options;
 }
 
 //==============================================================================
-MainComponent::MainComponent() : refreshButton(refreshButtonColours[getCurrentSynthModel()], "Refresh", 640, 130), currentModel(UNKNOWN), tooltipWindow(this, 1500) {
+MainComponent::MainComponent()
+    : refreshButton(refreshButtonColours[UNKNOWN], "Refresh", 640, 130), tooltipWindow(this, 1500), deviceMonitor(*this, ignoredMidiDevices) {
 
     // Set the look and feel, plastic texture and logo
 
@@ -46,14 +68,23 @@ MainComponent::MainComponent() : refreshButton(refreshButtonColours[getCurrentSy
     statusSection.setLookAndFeel(customLookAndFeel.get());
     lookAndFeel = std::move(customLookAndFeel);
 
-    // Load the texture image from binary data
-    MemoryInputStream memoryInputStream(BinaryData::plastic_png, BinaryData::plastic_pngSize, false);
-    auto textureImage = ImageFileFormat::loadFrom(memoryInputStream);
-
-    textureOverlay = std::make_unique<PlasticTexture>(textureImage);
+    // The texture is decoded in the background and swapped in when ready, so the window can show up right away
+    textureOverlay = std::make_unique<PlasticTexture>();
     textureOverlay->setBounds(0, 0, windowWidth, windowHeight);
+    Thread::launch([safeThis = SafePointer<MainComponent>(this)] {
+        MemoryInputStream memoryInputStream(BinaryData::plastic_png, BinaryData::plastic_pngSize, false);
+        auto textureImage = ImageFileFormat::loadFrom(memoryInputStream);
+
+        MessageManager::callAsync([safeThis, textureImage] {
+            if (safeThis != nullptr) {
+                safeThis->textureOverlay->setSourceImage(textureImage);
+                safeThis->startupStageDone("texture decoded");
+            }
+        });
+    });
 
     logo.setBounds(25, 30, 395, 60);
+    logo.onLoaded = [this] { startupStageDone("logo parsed"); };
     addAndMakeVisible(logo);
 
     // ========================= Sections labels =========================
@@ -73,57 +104,73 @@ MainComponent::MainComponent() : refreshButton(refreshButtonColours[getCurrentSy
     createLabel(statusTitleLabel, statusSection, "5tatu5    =", 398, 5, 250, 30);
     createLabel(statusLabel, statusSection, "Di5connected", 560, 5, 300, 30);
     createLabel(modelLabel, statusSection, "", 580, 5, 300, 30);
+    createLabel(analyzerLabel, statusSection, "", 10, 5, 380, 30);
     sysexDisabledUnderline.setVisible(false);
+    analyzerLabel.setVisible(false);
+    bankUploadBar.setBounds(10, 8, 380, 24);
+    statusSection.addChildComponent(bankUploadBar);
+
+    audioFormatManager.registerBasicFormats();
 
     refreshButton.setTooltip("Scan for a connected Ensoniq SQ-80 or ESQ-1 and for MIDI device changes");
     refreshButton.onClick = [this] {
         attemptConnection();
-        refreshMidiDevices();
+        deviceMonitor.rescan();
     };
 
     // ========================== MIDI Options ==========================
 
-    refreshMidiDevices(true);
+    // Devices are enumerated and opened in the background, the menus are filled once the first scan is done
+    deviceMonitor.onDevicesChanged = [this](const StringArray& inputNames, const StringArray& outputNames) {
+        midiInDeviceNames = inputNames;
+        midiOutDeviceNames = outputNames;
+        refreshMidiDevices(!initialDeviceScanDone);
+        if (!initialDeviceScanDone)
+            startupStageDone("MIDI devices enumerated");
+        initialDeviceScanDone = true;
+    };
+    deviceMonitor.onInputOpened = [this](std::unique_ptr<MidiInput> device) {
+        deviceMonitor.closeInput(std::move(midiTransport.input));
+        midiTransport.input = std::move(device);
+    };
+    deviceMonitor.onOutputOpened = [this](std::unique_ptr<MidiOutput> device) {
+        deviceMonitor.closeOutput(std::move(midiTransport.output));
+        midiTransport.output = std::move(device);
+    };
+    deviceMonitor.onDevicesSettled = [this] { attemptConnection(); };
+
+    ccMapper.onProgramSent = [this](const DeviceResponse& response) { MessageManager::callAsync([this, response] { updateStatus(response); }); };
+    controlServer.onProgramChanged = [this](const DeviceResponse& response) { MessageManager::callAsync([this, response] { updateStatus(response); }); };
+    controlServer.onConnectRequested = [this](std::function<void()> onFinished) { MessageManager::callAsync([this, onFinished] { attemptConnection(onFinished); }); };
+    midiProcessor.onVerifyFailed = [this](const MidiMessage& synthProgram) {
+        MessageManager::callAsync([this, synthProgram] {
+            // Show what the synth really has, or that it stopped answering
+            if (synthProgram.getSysExDataSize() == MidiSysexProcessor::SQ_ESQ_PROG_SIZE)
+                updateStatus(DeviceResponse(CONNECTED, synthProgram));
+            else
+                updateStatus(DeviceResponse(DISCONNECTED, NO_PROG));
+            AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "SideQick", "The synth did not take the last edit, even after sending it again");
+        });
+    };
 
     midiInMenu.setBounds(540, 20, 240, 25);
     midiInMenu.setText("Select MIDI Input Device");
     midiInMenu.setTooltip("MIDI input device used to receive data from the SQ-80 or ESQ-1");
-    // Select None or the first device in the list
-    midiInMenu.setSelectedItemIndex((midiInMenu.getNumItems() > 1));
 
     midiControls.addAndMakeVisible(midiInMenu);
-    midiInMenu.onChange = [this] {
-        auto midiInDevices = MidiInput::getAvailableDevices();
-        for (auto device : midiInDevices) {
-            // Search for the right midi device to open from its name from the context menu
-            if (device.name == midiInMenu.getText()) {
-                midiProcessor.selectedMidiIn = MidiInput::openDevice(device.identifier, this);
-                if (midiProcessor.selectedMidiIn) {
-                    midiProcessor.selectedMidiIn->start();
-                }
-                break;
-            }
-        }
-        attemptConnection();
-    };
+    midiInMenu.onChange = [this] { deviceMonitor.openInput(midiInMenu.getText()); };
 
     midiOutMenu.setBounds(540, 55, 240, 25);
     midiOutMenu.setText("Select MIDI Output Device");
     midiOutMenu.setTooltip("MIDI output device used to send data to the SQ-80 or ESQ-1");
-    // Select None or the first device in the list
-    midiOutMenu.setSelectedItemIndex((midiOutMenu.getNumItems() > 1));
 
     midiControls.addAndMakeVisible(midiOutMenu);
-    midiOutMenu.onChange = [this] {
-        auto midiOutDevices = MidiOutput::getAvailableDevices();
-        for (auto device : midiOutDevices) {
-            if (device.name == midiOutMenu.getText()) {
-                midiProcessor.selectedMidiOut = MidiOutput::openDevice(device.identifier);
-                break;
-            }
-        }
-        attemptConnection();
-    };
+    midiOutMenu.onChange = [this] { deviceMonitor.openOutput(midiOutMenu.getText()); };
+
+    // The ports of the last synth are selected again as soon as they are found
+    knownSynthMidiIn = connectionCache.getLastMidiIn();
+    knownSynthMidiOut = connectionCache.getLastMidiOut();
+    deviceMonitor.rescan();
 
     midiControls.setBounds(0, 0, windowWidth, windowHeight);
 
@@ -152,33 +199,42 @@ MainComponent::MainComponent() : refreshButton(refreshButtonColours[getCurrentSy
         String LFButtonTooltip = "Low-Frequency mode:\nShifts the frequency range down by a couple of octaves internally for oscillator " + String(osc + 1) +
                                  " when enabled. Displayed values are unchanged.";
 
-        createComboBox(waveMenus[osc], programControls, 90, oscControlsYPos[osc], 230, 25, waveMenuTooltip,
-                       [this, osc] { return midiProcessor.changeOscWaveform(osc, waveMenus[osc].getSelectedItemIndex() + NB_OF_WAVES[getCurrentSynthModel()] - 1); });
+        // The wave menu has its own onChange below
+        createComboBox(waveMenus[osc], programControls, 90, oscControlsYPos[osc], 230, 25, waveMenuTooltip, nullptr);
 
         createComboBox(
             octMenus[osc], programControls, 350, oscControlsYPos[osc], 125, 25, octMenuTooltip,
-            [this, osc] {
-                return midiProcessor.changeOscPitch(osc, octMenus[osc].getSelectedItemIndex() + 5, semiMenus[osc].getSelectedItemIndex(),
-                                                    LFButtons[osc].getToggleState());
+            [this, osc](MidiSysexProcessor& processor) {
+                return processor.changeOscPitch(osc, octMenus[osc].getSelectedItemIndex() + 5, semiMenus[osc].getSelectedItemIndex(), LFButtons[osc].getToggleState());
             },
             OSC_OCTAVE_MENU_OPTIONS);
 
         createComboBox(
             semiMenus[osc], programControls, 480, oscControlsYPos[osc], 70, 25, semiMenuTooltip,
-            [this, osc] {
-                return midiProcessor.changeOscPitch(osc, octMenus[osc].getSelectedItemIndex() + 5, semiMenus[osc].getSelectedItemIndex(),
-                                                    LFButtons[osc].getToggleState());
+            [this, osc](MidiSysexProcessor& processor) {
+                return processor.changeOscPitch(osc, octMenus[osc].getSelectedItemIndex() + 5, semiMenus[osc].getSelectedItemIndex(), LFButtons[osc].getToggleState());
             },
             OSC_SEMI_OPTIONS);
 
+        // Scrolling through the waves is instant while previewing, since the synth is left alone
+        waveMenus[osc].onChange = [this, osc] {
+            const auto model = getCurrentSynthModel();
+            const auto wave = waveMenus[osc].getSelectedItemIndex() + static_cast<int>(NB_OF_WAVES[model]) - 1;
+            if (analyzerSource.load() == ANALYZER_WAVE_PREVIEW)
+                wavePreview.setWave(osc, wave);
+            else
+                changeWaveOnAllUnits(osc, wave, model);
+        };
+
         createToggleButton(LFButtons[osc], programControls, 570, oscControlsYPos[osc] + 2, 20, 20, LFButtonTooltip,
-                           [this, osc] { return midiProcessor.toggleLowFrequencyMode(osc, LFButtons[osc].getToggleState()); });
+                           [this, osc](MidiSysexProcessor& processor) { return processor.toggleLowFrequencyMode(osc, LFButtons[osc].getToggleState()); });
     }
 
 
     // ------------------ Filter self-oscillation ------------------
     String selfOscButtonTooltip = "Filter self-oscillation:\nShifts the whole resonance range up internally to what would be values of 32-63 when enabled.";
-    createToggleButton(selfOscButton, programControls, 680, 132, 20, 20, selfOscButtonTooltip, [this] { return midiProcessor.toggleSelfOscillation(selfOscButton); });
+    createToggleButton(selfOscButton, programControls, 680, 132, 20, 20, selfOscButtonTooltip,
+                       [this](MidiSysexProcessor& processor) { return processor.toggleSelfOscillation(selfOscButton.getToggleState()); });
 
     programControls.setBounds(0, 0, displayWidth, displayHeight);
     programControls.setColour(GroupComponent::outlineColourId, Colours::transparentBlack);
@@ -210,40 +266,79 @@ MainComponent::MainComponent() : refreshButton(refreshButtonColours[getCurrentSy
 }
 
 MainComponent::~MainComponent() {
+    shutdownAudio();
+    audioFileTransport.setSource(nullptr);
+    midiProcessor.setReplayTransport(nullptr);
+    trafficReplayer = nullptr;
 
-    if (midiProcessor.selectedMidiIn)
-        midiProcessor.selectedMidiIn->stop();
+    if (midiTransport.input)
+        midiTransport.input->stop();
 
     display.setLookAndFeel(nullptr);
     stopTimer();
 }
 
 //==============================================================================
-void MainComponent::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {}
-void MainComponent::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) {}
-void MainComponent::releaseResources() {}
+void MainComponent::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
+    audioAnalyzer.prepare(sampleRate);
+    wavePreview.prepare(samplesPerBlockExpected, sampleRate);
+    audioFileTransport.prepareToPlay(samplesPerBlockExpected, sampleRate);
+}
+
+void MainComponent::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) {
+    const auto source = analyzerSource.load(std::memory_order_relaxed);
+
+    if (source == ANALYZER_WAVE_PREVIEW) {
+        auto* buffer = bufferToFill.buffer;
+        wavePreview.render(buffer->getWritePointer(0, bufferToFill.startSample), bufferToFill.numSamples);
+        audioAnalyzer.pushSamples(buffer->getReadPointer(0, bufferToFill.startSample), bufferToFill.numSamples);
+        for (int channel = 1; channel < buffer->getNumChannels(); channel++)
+            buffer->copyFrom(channel, bufferToFill.startSample, *buffer, 0, bufferToFill.startSample, bufferToFill.numSamples);
+        return;
+    }
+
+    if (source == ANALYZER_AUDIO_FILE) {
+        // The file is also played back, so what is analysed can be heard
+        audioFileTransport.getNextAudioBlock(bufferToFill);
+        audioAnalyzer.pushSamples(bufferToFill.buffer->getReadPointer(0, bufferToFill.startSample), bufferToFill.numSamples);
+        return;
+    }
+
+    // Only the first input channel is analysed. The output is silenced so the synth is not fed back to the speakers.
+    if (source == ANALYZER_AUDIO_INPUT && bufferToFill.buffer->getNumChannels() > 0)
+        audioAnalyzer.pushSamples(bufferToFill.buffer->getReadPointer(0, bufferToFill.startSample), bufferToFill.numSamples);
+    bufferToFill.clearActiveBufferRegion();
+}
+
+void MainComponent::releaseResources() { audioFileTransport.releaseResources(); }
 //==============================================================================
 
 void MainComponent::paint(Graphics& g) {
+    const auto themeColourIndex = getThemeColourIndex();
+    const auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
 
-    refreshButton.changeColour(refreshButtonColours[selectedThemeOption == AUTOMATIC_THEME ? currentModel
-                                                    : selectedThemeOption == NEUTRAL_THEME ? UNKNOWN
-                                                                                           : selectedThemeOption - 1]);
+    if (backgroundCache.isNull() || backgroundCacheTheme != themeColourIndex || backgroundCacheScale != scale)
+        renderBackgroundCache(themeColourIndex, scale);
 
-    Colour gradientColours[2];
-    for (int i = 0; i < 2; i++) {
-        gradientColours[i] = backgroundColours[selectedThemeOption == AUTOMATIC_THEME ? getCurrentSynthModel()
-                                               : selectedThemeOption == NEUTRAL_THEME ? UNKNOWN
-                                                                                      : selectedThemeOption - 1][i];
-    }
+    g.drawImage(backgroundCache, getLocalBounds().toFloat());
+}
+
+void MainComponent::renderBackgroundCache(unsigned int themeColourIndex, float scale) {
+    refreshButton.changeColour(refreshButtonColours[themeColourIndex]);
+
+    backgroundCache = Image(Image::RGB, roundToInt(windowWidth * scale), roundToInt(windowHeight * scale), false);
+    backgroundCacheTheme = themeColourIndex;
+    backgroundCacheScale = scale;
 
+    Graphics g(backgroundCache);
+    g.addTransform(AffineTransform::scale(scale));
+
+    const Colour* gradientColours = backgroundColours[themeColourIndex];
     g.setGradientFill(ColourGradient(gradientColours[0], 0, 0, gradientColours[1], (float)(windowWidth / 2), (float)windowHeight, true));
     g.fillAll();
 
     // Top red line
-    g.setColour(accentColours[selectedThemeOption == AUTOMATIC_THEME ? getCurrentSynthModel()
-                              : selectedThemeOption == NEUTRAL_THEME ? UNKNOWN
-                                                                     : selectedThemeOption - 1]);
+    g.setColour(accentColours[themeColourIndex]);
     g.drawLine(0, 0, (float)windowWidth, 0, (float)(separatorThickness * 1.5));
 
     // Thin red lines under logo
@@ -257,6 +352,10 @@ void MainComponent::paint(Graphics& g) {
     g.drawLine(370, 20, 370, 170, separatorThickness);
 }
 
+unsigned int MainComponent::getThemeColourIndex() const {
+    return selectedThemeOption == AUTOMATIC_THEME ? getCurrentSynthModel() : selectedThemeOption == NEUTRAL_THEME ? UNKNOWN : selectedThemeOption - 1;
+}
+
 void MainComponent::resized() {}
 
 void MainComponent::mouseDown(const juce::MouseEvent& event) {
@@ -279,7 +378,203 @@ void MainComponent::showContextMenu() {
         }));
     }
 
+    PopupMenu diagnosticsSubMenu;
+    diagnosticsSubMenu.addItem(PopupMenu::Item("Record MIDI traffic").setTicked(midiProcessor.trafficRecorder.isRecording()).setAction([this]() {
+        if (midiProcessor.trafficRecorder.isRecording())
+            midiProcessor.trafficRecorder.stop();
+        else
+            midiProcessor.trafficRecorder.start();
+    }));
+    diagnosticsSubMenu.addItem(PopupMenu::Item("Save MIDI recording...").setAction([this]() { saveMidiRecording(); }));
+    diagnosticsSubMenu.addItem(PopupMenu::Item("Verify program sends").setTicked(midiProcessor.isVerifyEnabled()).setAction([this]() {
+        midiProcessor.setVerifyEnabled(!midiProcessor.isVerifyEnabled());
+    }));
+    diagnosticsSubMenu.addSeparator();
+    diagnosticsSubMenu.addItem(PopupMenu::Item("Replay MIDI recording...").setAction([this]() { replayMidiRecording(1.0); }));
+    diagnosticsSubMenu.addItem(PopupMenu::Item("Replay MIDI recording (accelerated)...").setAction([this]() { replayMidiRecording(8.0); }));
+
+    PopupMenu analyzerSubMenu;
+    analyzerSubMenu.addItem(PopupMenu::Item("Analyze audio input")
+                                .setTicked(analyzerSource.load() == ANALYZER_AUDIO_INPUT)
+                                .setAction([this]() { startAudioInputAnalysis(); }));
+    analyzerSubMenu.addItem(PopupMenu::Item("Analyze audio file...")
+                                .setTicked(analyzerSource.load() == ANALYZER_AUDIO_FILE)
+                                .setAction([this]() { startAudioFileAnalysis(); }));
+    analyzerSubMenu.addItem(PopupMenu::Item("Stop").setEnabled(analyzerSource.load() != ANALYZER_OFF).setAction([this]() { stopAudioAnalysis(); }));
+
+    PopupMenu previewSubMenu;
+    previewSubMenu.addItem(PopupMenu::Item("Load wave ROM image...").setAction([this]() { loadWaveRom(); }));
+    previewSubMenu.addItem(PopupMenu::Item("Preview waves (approximate)")
+                               .setTicked(analyzerSource.load() == ANALYZER_WAVE_PREVIEW)
+                               .setEnabled(wavePreview.isRomLoaded() && synthState.getStatus() == CONNECTED && waveMenusNbOfWaves > 0)
+                               .setAction([this]() {
+                                   if (analyzerSource.load() == ANALYZER_WAVE_PREVIEW)
+                                       stopAudioAnalysis();
+                                   else
+                                       startWavePreview();
+                               }));
+    previewSubMenu.addSeparator();
+    // The ROM layout isn't documented, see WavePreviewEngine
+    previewSubMenu.addItem(PopupMenu::Item("Waves are guessed from the ROM image, the synth may sound different").setEnabled(false));
+
+    PopupMenu fingerprintsSubMenu;
+    const bool canCapture = analyzerSource.load() == ANALYZER_AUDIO_INPUT && captureMode == NO_CAPTURE;
+    fingerprintsSubMenu.addItem(PopupMenu::Item("Import wave recordings...").setAction([this]() { importWaveRecordings(); }));
+    fingerprintsSubMenu.addItem(PopupMenu::Item("Capture OSC 1 wave from audio input").setEnabled(canCapture && synthState.getStatus() == CONNECTED).setAction([this]() {
+        // The wave and octave come from the program, so the normal waves can be fingerprinted too. Fetching it may wait on the synth.
+        Thread::launch([this] {
+            auto currentProg = midiProcessor.getProgramToEdit(MidiSysexProcessor::FROM_CACHE);
+            if (currentProg.getSysExDataSize() != MidiSysexProcessor::SQ_ESQ_PROG_SIZE)
+                return;
+
+            MessageManager::callAsync([this, currentProg] {
+                // The analyzer may have been stopped in the meantime
+                if (analyzerSource.load() != ANALYZER_AUDIO_INPUT || captureMode != NO_CAPTURE)
+                    return;
+                capturedWave = ProgramParser::getNibblePair(currentProg.getSysExData(), ProgramParser::WAVE[OSC1]);
+                capturedOctave = (ProgramParser::getNibblePair(currentProg.getSysExData(), ProgramParser::PITCH[OSC1]) & ProgramParser::MAX_SEMI_NORMAL_RANGE) / 12 - 3;
+                capturedResults.clearQuick();
+                captureMode = CAPTURE_FINGERPRINT;
+            });
+        });
+    }));
+    fingerprintsSubMenu.addSeparator();
+    fingerprintsSubMenu.addItem(PopupMenu::Item("Find waves like audio input").setEnabled(canCapture && fingerprintIndex.getNumFingerprints() > 0).setAction([this]() {
+        capturedResults.clearQuick();
+        captureMode = CAPTURE_QUERY;
+    }));
+    fingerprintsSubMenu.addItem(
+        PopupMenu::Item("Find waves like audio file...").setEnabled(fingerprintIndex.getNumFingerprints() > 0).setAction([this]() { findWavesLikeAudioFile(); }));
+    fingerprintsSubMenu.addSeparator();
+    fingerprintsSubMenu.addItem(PopupMenu::Item("Clear " + String(fingerprintIndex.getNumFingerprints()) + " fingerprint(s)")
+                                    .setEnabled(fingerprintIndex.getNumFingerprints() > 0)
+                                    .setAction([this]() {
+                                        fingerprintIndex.clear();
+                                        fingerprintIndex.save();
+                                    }));
+
+    PopupMenu unitsSubMenu;
+    unitsSubMenu.addItem(PopupMenu::Item("Scan for other units").setAction([this]() { discoverOtherUnits(); }));
+    unitsSubMenu.addItem(PopupMenu::Item("Apply edits to all units")
+                             .setTicked(linkedEditing)
+                             .setEnabled(sessionManager.getNumSessions() > 0)
+                             .setAction([this]() { linkedEditing = !linkedEditing; }));
+    auto unitDescriptions = sessionManager.getSessionDescriptions();
+    if (!unitDescriptions.isEmpty()) {
+        unitsSubMenu.addSeparator();
+        for (auto& description : unitDescriptions)
+            unitsSubMenu.addItem(PopupMenu::Item(description).setEnabled(false));
+    }
+
+    PopupMenu ccSubMenu;
+    ccSubMenu.addItem(PopupMenu::Item("Enable MIDI CC control").setTicked(ccMapper.isEnabled()).setAction([this]() { ccMapper.setEnabled(!ccMapper.isEnabled()); }));
+    ccSubMenu.addSeparator();
+    for (int target = 0; target < MidiCcMapper::NB_OF_TARGETS; target++)
+        ccSubMenu.addItem(PopupMenu::Item(MidiCcMapper::TARGET_NAMES[target] + ":  CC " + String(ccMapper.getControllerNumber(static_cast<MidiCcMapper::Target>(target))))
+                              .setEnabled(false));
+
+    PopupMenu sequencerSubMenu;
+    const auto model = getCurrentSynthModel();
+    const bool canSequence = synthState.getStatus() == CONNECTED && !sequencer.isRunning();
+    sequencerSubMenu.addItem(PopupMenu::Item("Step OSC 1 through hidden waves").setEnabled(canSequence && waveMenusNbOfWaves > 0).setAction([this, model]() {
+        Array<ParameterSequencer::Step> steps;
+        for (int w = NB_OF_WAVES[model]; w < 256; w++)
+            steps.add([w](uint8_t* progData) { ProgramParser::setNibblePair(progData, ProgramParser::WAVE[OSC1], w); });
+        startSequencer(steps);
+    }));
+    sequencerSubMenu.addItem(PopupMenu::Item("Alternate OSC 1 LF mode").setEnabled(canSequence).setAction([this]() {
+        Array<ParameterSequencer::Step> steps;
+        steps.add([](uint8_t* progData) { ProgramParser::setLowFrequencyRange(progData, OSC1, true); });
+        steps.add([](uint8_t* progData) { ProgramParser::setLowFrequencyRange(progData, OSC1, false); });
+        startSequencer(steps);
+    }));
+    sequencerSubMenu.addItem(PopupMenu::Item("Stop").setEnabled(sequencer.isRunning()).setAction([this]() { stopSequencer(); }));
+    sequencerSubMenu.addSeparator();
+    for (auto bpm : {60.0, 90.0, 120.0, 140.0})
+        sequencerSubMenu.addItem(PopupMenu::Item(String(roundToInt(bpm)) + " BPM")
+                                     .setTicked(!sequencerSyncedToClock && sequencerBpm == bpm)
+                                     .setAction([this, bpm]() {
+                                         sequencerBpm = bpm;
+                                         sequencerSyncedToClock = false;
+                                     }));
+    sequencerSubMenu.addItem(PopupMenu::Item("Sync to MIDI clock").setTicked(sequencerSyncedToClock).setAction([this]() { sequencerSyncedToClock = true; }));
+
+    PopupMenu librarySubMenu;
+    // Waves from 75 up are hidden on every model
+    const int firstHiddenWave = static_cast<int>(NB_OF_WAVES[SQ80]);
+    const bool libraryLoaded = programLibrary.getNumPrograms() > 0;
+    librarySubMenu.addItem(PopupMenu::Item("Add folder of .syx files and librarian disk images...").setAction([this]() { addLibraryFolder(); }));
+    librarySubMenu.addSeparator();
+    librarySubMenu.addItem(PopupMenu::Item("Programs with hidden waves").setEnabled(libraryLoaded).setAction([this, firstHiddenWave]() {
+        showLibraryMatches("with hidden waves",
+                           ProgramLibrary::Query().whereAny({ProgramLibrary::WAVE_OSC1, ProgramLibrary::WAVE_OSC2, ProgramLibrary::WAVE_OSC3}, firstHiddenWave, 255));
+    }));
+    librarySubMenu.addItem(PopupMenu::Item("Programs with a self-oscillating filter").setEnabled(libraryLoaded).setAction([this]() {
+        showLibraryMatches("with a self-oscillating filter", ProgramLibrary::Query().where(ProgramLibrary::RESONANCE, 32, 255));
+    }));
+    librarySubMenu.addItem(PopupMenu::Item("Hidden waves, self-oscillating filter and LF on OSC 3").setEnabled(libraryLoaded).setAction([this, firstHiddenWave]() {
+        showLibraryMatches("with hidden waves, a self-oscillating filter and LF on OSC 3",
+                           ProgramLibrary::Query()
+                               .whereAny({ProgramLibrary::WAVE_OSC1, ProgramLibrary::WAVE_OSC2, ProgramLibrary::WAVE_OSC3}, firstHiddenWave, 255)
+                               .where(ProgramLibrary::RESONANCE, 32, 255)
+                               .where(ProgramLibrary::PITCH_OSC3, ProgramParser::MAX_SEMI_NORMAL_RANGE + 1, 255));
+    }));
+    librarySubMenu.addItem(PopupMenu::Item("Programs like the current one")
+                               .setEnabled(similarityIndex.getNumPrograms() > 0 && synthState.getStatus() == CONNECTED)
+                               .setAction([this]() { showProgramsLikeCurrent(); }));
+    librarySubMenu.addSeparator();
+    librarySubMenu.addItem(PopupMenu::Item("Clear " + String(programLibrary.getNumPrograms()) + " program(s)").setEnabled(libraryLoaded).setAction([this]() {
+        programLibrary.clear();
+        Thread::launch([this] { similarityIndex.build({}); });
+    }));
+
+    PopupMenu memorySubMenu;
+    memorySubMenu.addItem(PopupMenu::Item("Send bank file to the synth...")
+                              .setEnabled(synthState.getStatus() == CONNECTED && !bankUploadBar.isVisible())
+                              .setAction([this]() { uploadBankFile(); }));
+    memorySubMenu.addSeparator();
+    PopupMenu conversionSubMenu;
+    for (auto conversion : {std::make_pair(SQ80, ESQ1), std::make_pair(ESQ1, SQ80), std::make_pair(SQ80, ESQM), std::make_pair(ESQ1, ESQM)})
+        conversionSubMenu.addItem(MODEL_NAMES[conversion.first] + " to " + MODEL_NAMES[conversion.second] + "...",
+                                  [this, conversion]() { convertBankFile(conversion.first, conversion.second); });
+    memorySubMenu.addSubMenu("Convert bank file", conversionSubMenu);
+    memorySubMenu.addItem(PopupMenu::Item("Extract programs from librarian disk image...").setAction([this]() { extractDiskImage(); }));
+    memorySubMenu.addItem(PopupMenu::Item("Import wave equivalences... (" + String(waveTranslator.getNbOfEquivalences()) + " known)")
+                              .setAction([this]() { importWaveEquivalences(); }));
+
+    PopupMenu remoteSubMenu;
+    remoteSubMenu.addItem(PopupMenu::Item("Control server on port " + String(ControlServer::DEFAULT_PORT)).setTicked(controlServer.isRunning()).setAction([this]() {
+        if (controlServer.isRunning())
+            controlServer.stop();
+        else if (!controlServer.start())
+            AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "SideQick",
+                                             "Could not listen on port " + String(ControlServer::DEFAULT_PORT) + ", it may be in use");
+    }));
+    if (controlServer.isRunning())
+        remoteSubMenu.addItem(PopupMenu::Item(String(controlServer.getNbOfClients()) + " client(s) connected").setEnabled(false));
+
+    PopupMenu scriptsSubMenu;
+    scriptsSubMenu.addItem(PopupMenu::Item("Load script...").setAction([this]() { loadProgramScript(); }));
+    scriptsSubMenu.addSeparator();
+    scriptsSubMenu.addItem(PopupMenu::Item("Run " + (programScript.isLoaded() ? programScriptName : String("script")) + " on current program")
+                               .setEnabled(programScript.isLoaded() && synthState.getStatus() == CONNECTED)
+                               .setAction([this]() { runScriptOnCurrentProgram(); }));
+    scriptsSubMenu.addItem(PopupMenu::Item("Run " + (programScript.isLoaded() ? programScriptName : String("script")) + " on bank file...")
+                               .setEnabled(programScript.isLoaded())
+                               .setAction([this]() { runScriptOnBankFile(); }));
+
     menu.addSubMenu("Theme", themeSubMenu);
+    menu.addSubMenu("Other units", unitsSubMenu);
+    menu.addSubMenu("MIDI CC control", ccSubMenu);
+    menu.addSubMenu("Sequencer", sequencerSubMenu);
+    menu.addSubMenu("Scripts", scriptsSubMenu);
+    menu.addSubMenu("Program library", librarySubMenu);
+    menu.addSubMenu("Synth memory", memorySubMenu);
+    menu.addSubMenu("Remote control", remoteSubMenu);
+    menu.addSubMenu("Audio analyzer", analyzerSubMenu);
+    menu.addSubMenu("Wave preview", previewSubMenu);
+    menu.addSubMenu("Wave fingerprints", fingerprintsSubMenu);
+    menu.addSubMenu("Diagnostics", diagnosticsSubMenu);
     menu.addItem(2, "About SideQick...");
     menu.addItem(3, "Quit");
     menu.showMenuAsync(PopupMenu::Options(), [this](int result) {
@@ -292,7 +587,496 @@ void MainComponent::showContextMenu() {
     });
 }
 
-void MainComponent::handleIncomingMidiMessage(MidiInput* source, const MidiMessage& message) { midiProcessor.processIncomingMidiData(source, message); }
+void MainComponent::discoverOtherUnits() {
+    // The ports used by the main window are left out, the main unit is already handled by midiProcessor
+    StringArray usedDevices = {midiInMenu.getText(), midiOutMenu.getText()};
+    Thread::launch([this, usedDevices] {
+        sessionManager.discover(usedDevices, [this](int nbOfUnits) {
+            if (nbOfUnits == 0)
+                linkedEditing = false;
+            AlertWindow::showMessageBoxAsync(AlertWindow::InfoIcon, "SideQick",
+                                             nbOfUnits == 0 ? String("No other unit was found") : "Found " + String(nbOfUnits) + " other unit(s):\n\n" +
+                                                                                                    sessionManager.getSessionDescriptions().joinIntoString("\n"));
+        });
+    });
+}
+
+void MainComponent::startSequencer(const Array<ParameterSequencer::Step>& steps) {
+    // The steps are rendered from the current program, which may have to be requested from the synth first
+    Thread::launch([this, steps] {
+        if (!sequencer.start(steps, sequencerBpm, SEQUENCER_STEPS_PER_BEAT, sequencerSyncedToClock))
+            MessageManager::callAsync(
+                [] { AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "SideQick", "The sequencer could not get the current program from the synth"); });
+    });
+}
+
+void MainComponent::stopSequencer() {
+    sequencer.stop();
+    auto stats = sequencer.getJitterStats();
+    AlertWindow::showMessageBoxAsync(AlertWindow::InfoIcon, "SideQick",
+                                     "Sequencer stopped after " + String(stats.nbOfSteps) + " steps\n\nMean timing jitter: " + String(stats.meanJitterMs, 2) +
+                                         " ms\nMaximum timing jitter: " + String(stats.maxJitterMs, 2) + " ms");
+    // Bring the display back in sync with what the synth is playing
+    attemptConnection();
+}
+
+void MainComponent::saveMidiRecording() {
+    fileChooser = std::make_unique<FileChooser>("Save MIDI recording", File::getSpecialLocation(File::userDocumentsDirectory).getChildFile("SideQick.sqkr"), "*.sqkr");
+    fileChooser->launchAsync(FileBrowserComponent::saveMode | FileBrowserComponent::canSelectFiles | FileBrowserComponent::warnAboutOverwriting,
+                             [this](const FileChooser& chooser) {
+                                 auto file = chooser.getResult();
+                                 if (file != File() && !midiProcessor.trafficRecorder.saveToFile(file))
+                                     AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "SideQick",
+                                                                      "Could not save the MIDI recording to " + file.getFullPathName());
+                             });
+}
+
+void MainComponent::replayMidiRecording(double speed) {
+    fileChooser = std::make_unique<FileChooser>("Replay MIDI recording", File::getSpecialLocation(File::userDocumentsDirectory), "*.sqkr");
+    fileChooser->launchAsync(FileBrowserComponent::openMode | FileBrowserComponent::canSelectFiles, [this, speed](const FileChooser& chooser) {
+        auto file = chooser.getResult();
+        if (file == File())
+            return;
+
+        midiProcessor.setReplayTransport(nullptr);
+        trafficReplayer = std::make_unique<MidiTrafficReplayer>(midiProcessor);
+        if (!trafficReplayer->load(file)) {
+            AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "SideQick", file.getFileName() + " is not a valid MIDI recording");
+            return;
+        }
+
+        // The processor goes through the same connection sequence as in the recorded session, but receives its responses from the recording
+        midiProcessor.setReplayTransport(trafficReplayer.get());
+        trafficReplayer->onReplayFinished = [this, replayer = trafficReplayer.get()] {
+            MessageManager::callAsync([this, replayer] {
+                // A newer replay may have started in the meantime
+                if (trafficReplayer.get() == replayer)
+                    midiProcessor.setReplayTransport(nullptr);
+            });
+        };
+
+        updateStatus(DeviceResponse(REFRESHING, NO_PROG));
+        trafficReplayer->startReplay(speed);
+        Thread::launch([this] {
+            auto response = midiProcessor.requestDeviceInquiry();
+            MessageManager::callAsync([this, response] { updateStatus(response); });
+        });
+    });
+}
+
+void MainComponent::startAudioInputAnalysis() {
+    stopAudioAnalysis();
+    analyzerSource.store(ANALYZER_AUDIO_INPUT);
+    // One input for the synth's output, the output channels are only there to keep the device callback running
+    setAudioChannels(1, 2);
+    analyzerLabel.setVisible(true);
+}
+
+void MainComponent::startAudioFileAnalysis() {
+    fileChooser = std::make_unique<FileChooser>("Analyze audio file", File::getSpecialLocation(File::userDocumentsDirectory),
+                                                audioFormatManager.getWildcardForAllFormats());
+    fileChooser->launchAsync(FileBrowserComponent::openMode | FileBrowserComponent::canSelectFiles, [this](const FileChooser& chooser) {
+        auto file = chooser.getResult();
+        if (file == File())
+            return;
+
+        auto* reader = audioFormatManager.createReaderFor(file);
+        if (reader == nullptr) {
+            AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "SideQick", file.getFileName() + " is not a supported audio file");
+            return;
+        }
+
+        stopAudioAnalysis();
+        // The file is read ahead on its own thread, so the audio callback never waits on the disk
+        audioFileReadThread.startThread();
+        auto newSource = std::make_unique<AudioFormatReaderSource>(reader, true);
+        newSource->setLooping(true);
+        audioFileTransport.setSource(newSource.get(), 32768, &audioFileReadThread, reader->sampleRate);
+        audioFileSource = std::move(newSource);
+
+        analyzerSource.store(ANALYZER_AUDIO_FILE);
+        setAudioChannels(0, 2);
+        audioFileTransport.start();
+        analyzerLabel.setVisible(true);
+    });
+}
+
+void MainComponent::stopAudioAnalysis() {
+    const bool wasPreviewing = analyzerSource.load() == ANALYZER_WAVE_PREVIEW;
+    shutdownAudio();
+    analyzerSource.store(ANALYZER_OFF);
+    audioFileTransport.stop();
+    audioFileTransport.setSource(nullptr);
+    audioFileSource = nullptr;
+    analyzerLabel.setVisible(false);
+    captureMode = NO_CAPTURE;
+
+    // The menus may show previewed waves the synth never received
+    if (wasPreviewing)
+        attemptConnection();
+}
+
+void MainComponent::loadWaveRom() {
+    fileChooser = std::make_unique<FileChooser>("Load wave ROM image", File::getSpecialLocation(File::userDocumentsDirectory), "*.bin;*.rom");
+    fileChooser->launchAsync(FileBrowserComponent::openMode | FileBrowserComponent::canSelectFiles, [this](const FileChooser& chooser) {
+        auto file = chooser.getResult();
+        if (file != File() && !wavePreview.loadWaveRom(file))
+            AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "SideQick", "Could not load the wave ROM image " + file.getFileName());
+    });
+}
+
+void MainComponent::startWavePreview() {
+    // Fetching the program may wait on the synth
+    Thread::launch([this] {
+        auto currentProg = midiProcessor.getProgramToEdit(MidiSysexProcessor::FROM_CACHE);
+        if (currentProg.getSysExDataSize() != MidiSysexProcessor::SQ_ESQ_PROG_SIZE)
+            return;
+
+        MessageManager::callAsync([this, currentProg] {
+            stopAudioAnalysis();
+            wavePreview.setProgram(currentProg.getSysExData());
+            analyzerSource.store(ANALYZER_WAVE_PREVIEW);
+            setAudioChannels(0, 2);
+            analyzerLabel.setVisible(true);
+        });
+    });
+}
+
+void MainComponent::importWaveRecordings() {
+    fileChooser = std::make_unique<FileChooser>("Folder of wave recordings (named like WAV112_OCT-1.wav)", File::getSpecialLocation(File::userDocumentsDirectory));
+    fileChooser->launchAsync(FileBrowserComponent::openMode | FileBrowserComponent::canSelectDirectories, [this](const FileChooser& chooser) {
+        auto folder = chooser.getResult();
+        if (folder == File())
+            return;
+
+        Thread::launch([this, folder] {
+            const auto nbOfRecordings = fingerprintIndex.addRecordingsFromFolder(folder);
+            fingerprintIndex.save();
+            MessageManager::callAsync([nbOfRecordings] {
+                AlertWindow::showMessageBoxAsync(AlertWindow::InfoIcon, "SideQick", "Added " + String(nbOfRecordings) + " wave recording(s) to the fingerprints");
+            });
+        });
+    });
+}
+
+void MainComponent::findWavesLikeAudioFile() {
+    fileChooser = std::make_unique<FileChooser>("Find waves like audio file", File::getSpecialLocation(File::userDocumentsDirectory),
+                                                audioFormatManager.getWildcardForAllFormats());
+    fileChooser->launchAsync(FileBrowserComponent::openMode | FileBrowserComponent::canSelectFiles, [this](const FileChooser& chooser) {
+        auto file = chooser.getResult();
+        if (file == File())
+            return;
+
+        Thread::launch([this, file] {
+            Array<AudioAnalyzer::Result> results;
+            AudioAnalyzer::analyseFile(file, results);
+            MessageManager::callAsync([this, results] { showSimilarWaves(results); });
+        });
+    });
+}
+
+void MainComponent::showSimilarWaves(const Array<AudioAnalyzer::Result>& results) {
+    Array<WaveFingerprintIndex::Match> matches;
+    const auto startTime = Time::getMillisecondCounterHiRes();
+    if (!fingerprintIndex.findSimilar(results, 5, matches)) {
+        AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "SideQick", "The sample is too quiet to be compared with the waves");
+        return;
+    }
+    const auto searchTime = Time::getMillisecondCounterHiRes() - startTime;
+
+    String text;
+    for (auto& match : matches)
+        text << "WAV" << match.entry.wave << "    OCT " << (match.entry.octave >= 0 ? "+" : "") << match.entry.octave << "    " << roundToInt(match.similarity * 100.0f)
+             << "% similar\n";
+    text << "\nSearched " << fingerprintIndex.getNumFingerprints() << " fingerprints in " << String(searchTime, 3) << " ms";
+    AlertWindow::showMessageBoxAsync(AlertWindow::InfoIcon, "SideQick", text);
+}
+
+void MainComponent::loadProgramScript() {
+    fileChooser = std::make_unique<FileChooser>("Load script", File::getSpecialLocation(File::userDocumentsDirectory), "*.js");
+    fileChooser->launchAsync(FileBrowserComponent::openMode | FileBrowserComponent::canSelectFiles, [this](const FileChooser& chooser) {
+        auto file = chooser.getResult();
+        if (file == File())
+            return;
+
+        auto result = programScript.load(file.loadFileAsString());
+        if (result.failed())
+            AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "SideQick", "Could not load " + file.getFileName() + "\n\n" + result.getErrorMessage());
+        else
+            programScriptName = file.getFileNameWithoutExtension();
+    });
+}
+
+void MainComponent::runScriptOnCurrentProgram() {
+    updateStatus(DeviceResponse(MODIFYING_PROGRAM, NO_PROG));
+
+    Thread::launch([this] {
+        auto currentProg = midiProcessor.getProgramToEdit(MidiSysexProcessor::FROM_CACHE);
+        if (currentProg.getSysExDataSize() != MidiSysexProcessor::SQ_ESQ_PROG_SIZE) {
+            MessageManager::callAsync([this] { updateStatus(DeviceResponse(DISCONNECTED, NO_PROG)); });
+            return;
+        }
+
+        HeapBlock<uint8_t> progData(MidiSysexProcessor::SQ_ESQ_PROG_SIZE);
+        memcpy(progData.getData(), currentProg.getSysExData(), MidiSysexProcessor::SQ_ESQ_PROG_SIZE);
+
+        // Nothing is sent if the script fails halfway, the synth keeps its program
+        auto result = programScript.apply(progData);
+        for (int osc = 0; osc < 3 && result.wasOk(); osc++)
+            if (!synthState.canPlayWave(ProgramParser::getNibblePair(progData, ProgramParser::WAVE[osc])))
+                result = Result::fail("The synth can't play hidden waves, the program was not sent");
+        if (result.wasOk()) {
+            midiProcessor.sendProgramDump(progData);
+            currentProg = MidiMessage::createSysExMessage(progData, MidiSysexProcessor::SQ_ESQ_PROG_SIZE);
+        }
+
+        MessageManager::callAsync([this, result, currentProg] {
+            updateStatus(DeviceResponse(CONNECTED, currentProg));
+            if (result.failed())
+                AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "SideQick", programScriptName + " failed\n\n" + result.getErrorMessage());
+        });
+    });
+}
+
+void MainComponent::runScriptOnBankFile() {
+    fileChooser = std::make_unique<FileChooser>("Run " + programScriptName + " on bank", File::getSpecialLocation(File::userDocumentsDirectory), "*.syx");
+    fileChooser->launchAsync(FileBrowserComponent::openMode | FileBrowserComponent::canSelectFiles, [this](const FileChooser& chooser) {
+        auto file = chooser.getResult();
+        if (file == File())
+            return;
+
+        // A bank file is a single all-programs dump, with its F0 and F7
+        MemoryBlock bankDump;
+        if (!file.loadFileAsData(bankDump) || bankDump.getSize() != static_cast<size_t>(ProgramParser::BANK_DATA_SIZE + 2) ||
+            !ProgramParser::isBankDump(static_cast<const uint8_t*>(bankDump.getData()) + 1, ProgramParser::BANK_DATA_SIZE)) {
+            AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "SideQick", file.getFileName() + " is not an SQ-80/ESQ-1 bank dump");
+            return;
+        }
+
+        Thread::launch([this, file, bankDump]() mutable {
+            const auto startTime = Time::getMillisecondCounterHiRes();
+            auto result = programScript.applyToBank(static_cast<uint8_t*>(bankDump.getData()) + 1);
+            const auto runTime = Time::getMillisecondCounterHiRes() - startTime;
+
+            auto outputFile = file.getSiblingFile(file.getFileNameWithoutExtension() + " " + programScriptName + ".syx").getNonexistentSibling();
+            if (result.wasOk() && !outputFile.replaceWithData(bankDump.getData(), bankDump.getSize()))
+                result = Result::fail("Could not write " + outputFile.getFullPathName());
+
+            MessageManager::callAsync([this, result, outputFile, runTime] {
+                if (result.failed())
+                    AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "SideQick", programScriptName + " failed\n\n" + result.getErrorMessage());
+                else
+                    AlertWindow::showMessageBoxAsync(AlertWindow::InfoIcon, "SideQick",
+                                                     "Ran " + programScriptName + " on " + String(ProgramParser::NB_OF_PROGS_IN_BANK) + " programs in " +
+                                                         String(runTime, 1) + " ms\n\nSaved as " + outputFile.getFileName());
+            });
+        });
+    });
+}
+
+void MainComponent::addLibraryFolder() {
+    fileChooser = std::make_unique<FileChooser>("Folder of .syx files", File::getSpecialLocation(File::userDocumentsDirectory));
+    fileChooser->launchAsync(FileBrowserComponent::openMode | FileBrowserComponent::canSelectDirectories, [this](const FileChooser& chooser) {
+        auto folder = chooser.getResult();
+        if (folder == File())
+            return;
+
+        Thread::launch([this, folder] {
+            const auto startTime = Time::getMillisecondCounterHiRes();
+            const auto nbOfPrograms = programLibrary.addFolder(folder);
+            const auto loadTime = Time::getMillisecondCounterHiRes() - startTime;
+            const auto nbOfProgramsInLibrary = programLibrary.getNumPrograms();
+
+            // The similarity index is rebuilt from the whole library, the previous one answers until it's done
+            const auto indexStartTime = Time::getMillisecondCounterHiRes();
+            similarityIndex.build(programLibrary.getSourceFiles());
+            const auto indexTime = Time::getMillisecondCounterHiRes() - indexStartTime;
+
+            MessageManager::callAsync([nbOfPrograms, loadTime, nbOfProgramsInLibrary, indexTime] {
+                AlertWindow::showMessageBoxAsync(AlertWindow::InfoIcon, "SideQick",
+                                                 "Added " + String(nbOfPrograms) + " program(s) in " + String(loadTime, 0) + " ms\n\nThe library has " +
+                                                     String(nbOfProgramsInLibrary) + " program(s), indexed for similarity in " + String(indexTime, 0) + " ms");
+            });
+        });
+    });
+}
+
+void MainComponent::showLibraryMatches(const String& description, const ProgramLibrary::Query& query) {
+    const auto startTime = Time::getMillisecondCounterHiRes();
+    const auto rows = programLibrary.find(query);
+    const auto searchTime = Time::getMillisecondCounterHiRes() - startTime;
+
+    const int maxNbOfListedMatches = 10;
+    String text;
+    text << rows.size() << " of " << programLibrary.getNumPrograms() << " program(s) " << description << "\n\n";
+    for (int matchIdx = 0; matchIdx < jmin(rows.size(), maxNbOfListedMatches); matchIdx++) {
+        const auto source = programLibrary.getSource(rows[matchIdx]);
+        text << source.file.getFileName() << "    program " << source.position + 1 << "\n";
+    }
+    if (rows.size() > maxNbOfListedMatches)
+        text << "...\n";
+    text << "\nSearched in " << String(searchTime, 3) << " ms";
+    AlertWindow::showMessageBoxAsync(AlertWindow::InfoIcon, "SideQick", text);
+}
+
+void MainComponent::showProgramsLikeCurrent() {
+    // Fetching the program may wait on the synth when the cached one is stale
+    Thread::launch([this] {
+        // The last program fetched from the synth or sent to it
+        auto currentProg = midiProcessor.getProgramToEdit(MidiSysexProcessor::FROM_CACHE);
+        if (currentProg.getSysExDataSize() != MidiSysexProcessor::SQ_ESQ_PROG_SIZE)
+            return;
+
+        const auto startTime = Time::getMillisecondCounterHiRes();
+        const auto matches = similarityIndex.findSimilar(currentProg.getSysExData(), 10);
+        const auto searchTime = Time::getMillisecondCounterHiRes() - startTime;
+
+        String text("Programs most like the current one:\n\n");
+        for (auto& match : matches)
+            text << match.source.file.getFileName() << "    program " << match.source.position + 1 << "    " << roundToInt(jmax(0.0f, match.similarity) * 100.0f)
+                 << "% similar\n";
+        text << "\nSearched " << similarityIndex.getNumPrograms() << " programs in " << String(searchTime, 3) << " ms";
+        MessageManager::callAsync([text] { AlertWindow::showMessageBoxAsync(AlertWindow::InfoIcon, "SideQick", text); });
+    });
+}
+
+void MainComponent::uploadBankFile() {
+    fileChooser = std::make_unique<FileChooser>("Send bank to the synth", File::getSpecialLocation(File::userDocumentsDirectory), "*.syx");
+    fileChooser->launchAsync(FileBrowserComponent::openMode | FileBrowserComponent::canSelectFiles, [this](const FileChooser& chooser) {
+        auto file = chooser.getResult();
+        if (file == File())
+            return;
+
+        MemoryBlock bankDump;
+        if (!file.loadFileAsData(bankDump) || bankDump.getSize() != static_cast<size_t>(ProgramParser::BANK_DATA_SIZE + 2) ||
+            !ProgramParser::isBankDump(static_cast<const uint8_t*>(bankDump.getData()) + 1, ProgramParser::BANK_DATA_SIZE)) {
+            AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "SideQick", file.getFileName() + " is not an SQ-80/ESQ-1 bank dump");
+            return;
+        }
+
+        AlertWindow::showOkCancelBox(AlertWindow::WarningIcon, "SideQick",
+                                     "This replaces the 40 programs in the synth's memory with the ones in " + file.getFileName() +
+                                         ".\n\nMemory protect must be off on the synth.",
+                                     "Send", "Cancel", nullptr, ModalCallbackFunction::create([this, bankDump](int result) mutable {
+                                         if (result == 0)
+                                             return;
+
+                                         // The bank goes to the channel of the synth we're connected to
+                                         auto* bankData = static_cast<uint8_t*>(bankDump.getData()) + 1;
+                                         bankData[2] = static_cast<uint8_t>(midiProcessor.getChannel().getIntValue() - 1);
+
+                                         bankUploadProgress = 0.0;
+                                         bankUploadBar.setVisible(true);
+                                         analyzerLabel.setVisible(false);
+
+                                         Thread::launch([this, bankDump] {
+                                             // The progress bar reads the progress on the message thread
+                                             const auto onProgress = [this](double progress) {
+                                                 MessageManager::callAsync([this, progress] { bankUploadProgress = progress; });
+                                             };
+                                             const auto upload = midiProcessor.uploadBank(static_cast<const uint8_t*>(bankDump.getData()) + 1, onProgress);
+                                             MessageManager::callAsync([this, upload] {
+                                                 bankUploadBar.setVisible(false);
+                                                 analyzerLabel.setVisible(analyzerSource.load() != ANALYZER_OFF);
+                                                 if (upload.confirmed)
+                                                     AlertWindow::showMessageBoxAsync(AlertWindow::InfoIcon, "SideQick",
+                                                                                      "Bank sent in " + String(upload.durationMs / 1000.0, 2) + " s (" +
+                                                                                          String(upload.bytesPerSecond, 0) + " bytes/s)");
+                                                 else
+                                                     AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "SideQick",
+                                                                                      "The synth did not answer after the bank. Check that its memory protect is off.");
+                                             });
+                                         });
+                                     }));
+    });
+}
+
+void MainComponent::convertBankFile(SynthModel from, SynthModel to) {
+    const auto conversionName = MODEL_NAMES[from] + " to " + MODEL_NAMES[to];
+    fileChooser = std::make_unique<FileChooser>("Convert " + conversionName, File::getSpecialLocation(File::userDocumentsDirectory), "*.syx");
+    fileChooser->launchAsync(FileBrowserComponent::openMode | FileBrowserComponent::canSelectFiles, [this, from, to](const FileChooser& chooser) {
+        auto file = chooser.getResult();
+        if (file == File())
+            return;
+
+        MemoryBlock bankDump;
+        if (!file.loadFileAsData(bankDump) || bankDump.getSize() != static_cast<size_t>(ProgramParser::BANK_DATA_SIZE + 2) ||
+            !ProgramParser::isBankDump(static_cast<const uint8_t*>(bankDump.getData()) + 1, ProgramParser::BANK_DATA_SIZE)) {
+            AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "SideQick", file.getFileName() + " is not an SQ-80/ESQ-1 bank dump");
+            return;
+        }
+
+        const auto report = waveTranslator.translateBank(static_cast<uint8_t*>(bankDump.getData()) + 1, from, to);
+        const auto outputFile = file.getSiblingFile(file.getFileNameWithoutExtension() + " for " + MODEL_NAMES[to] + ".syx").getNonexistentSibling();
+        if (!outputFile.replaceWithData(bankDump.getData(), bankDump.getSize())) {
+            AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "SideQick", "Could not write " + outputFile.getFullPathName());
+            return;
+        }
+
+        const int maxNbOfListedProblems = 10;
+        String text;
+        text << "Changed the waves of " << report.nbOfProgramsChanged << " program(s), saved as " << outputFile.getFileName() << "\n";
+        if (!report.problems.isEmpty()) {
+            text << "\n" << report.problems.size() << " wave(s) have no equivalent on the " << MODEL_NAMES[to] << " and were left as they were:\n\n";
+            for (int problemIdx = 0; problemIdx < jmin(report.problems.size(), maxNbOfListedProblems); problemIdx++) {
+                const auto& problem = report.problems.getReference(problemIdx);
+                text << "Program " << problem.programIdx + 1 << ", OSC " << problem.osc + 1 << ": wave " << problem.wave << "\n";
+            }
+            if (report.problems.size() > maxNbOfListedProblems)
+                text << "...\n";
+        }
+        AlertWindow::showMessageBoxAsync(report.problems.isEmpty() ? AlertWindow::InfoIcon : AlertWindow::WarningIcon, "SideQick", text);
+    });
+}
+
+void MainComponent::importWaveEquivalences() {
+    fileChooser = std::make_unique<FileChooser>("Import wave equivalences", File::getSpecialLocation(File::userDocumentsDirectory), "*.txt");
+    fileChooser->launchAsync(FileBrowserComponent::openMode | FileBrowserComponent::canSelectFiles, [this](const FileChooser& chooser) {
+        auto file = chooser.getResult();
+        if (file == File())
+            return;
+
+        const auto nbOfEquivalences = waveTranslator.importTable(file);
+        if (nbOfEquivalences <= 0)
+            AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "SideQick",
+                                             "No wave equivalence found in " + file.getFileName() + ".\n\nEach line should look like: SQ-80 112 = ESQ-1 47");
+        else
+            AlertWindow::showMessageBoxAsync(AlertWindow::InfoIcon, "SideQick", "Imported " + String(nbOfEquivalences) + " wave equivalence(s)");
+    });
+}
+
+void MainComponent::extractDiskImage() {
+    fileChooser = std::make_unique<FileChooser>("Extract programs from librarian disk image", File::getSpecialLocation(File::userDocumentsDirectory),
+                                                DiskImage::FILE_PATTERNS);
+    fileChooser->launchAsync(FileBrowserComponent::openMode | FileBrowserComponent::canSelectFiles, [](const FileChooser& chooser) {
+        auto file = chooser.getResult();
+        if (file == File())
+            return;
+
+        DiskImage image(file);
+        if (!image.isOpen()) {
+            const auto message = file.getFileName() + " is not a FAT disk image written by a librarian.\n\nDisks formatted by the SQ-80 can't be read yet.";
+            AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "SideQick", message);
+            return;
+        }
+
+        // Each program and bank goes to its own .syx file, to be converted, edited or sent to the synth like any other
+        const auto folder = file.getSiblingFile(file.getFileNameWithoutExtension()).getNonexistentSibling();
+        const auto nbOfFilesWritten = image.extractDumps(folder);
+        if (nbOfFilesWritten == 0)
+            AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "SideQick", "No program or bank dump found on " + file.getFileName());
+        else
+            AlertWindow::showMessageBoxAsync(AlertWindow::InfoIcon, "SideQick",
+                                             "Extracted " + String(nbOfFilesWritten) + " dump(s) from " + String(image.getEntries().size()) +
+                                                 " file(s) to " + folder.getFullPathName());
+    });
+}
+
+void MainComponent::handleIncomingMidiMessage(MidiInput* source, const MidiMessage& message) {
+    // Mapped controllers and MIDI clock take the realtime paths and never reach the SysEx processing
+    if (!ccMapper.handleControllerMessage(message) && !sequencer.handleClockMessage(message))
+        midiProcessor.processIncomingMidiData(message);
+}
 
 void MainComponent::updateStatus(DeviceResponse response) {
 
@@ -301,21 +1085,29 @@ void MainComponent::updateStatus(DeviceResponse response) {
         statusLabel.setBounds(center ? 560 : 500, 5, 300, 30);
     };
     auto updateModelLabel = [this](DeviceResponse response) {
-        modelLabel.setVisible(response.status == STATUS_MESSAGES[CONNECTED] || response.status == STATUS_MESSAGES[SYSEX_DISABLED]);
-        modelLabel.setBounds(response.status == STATUS_MESSAGES[SYSEX_DISABLED] ? modelLabelXPos + 55 : modelLabelXPos, modelLabel.getY(), modelLabel.getWidth(),
+        modelLabel.setVisible(response.status == CONNECTED || response.status == SYSEX_DISABLED);
+        modelLabel.setBounds(response.status == SYSEX_DISABLED ? modelLabelXPos + 55 : modelLabelXPos, modelLabel.getY(), modelLabel.getWidth(),
                              modelLabel.getHeight());
         modelLabel.setTooltip("MIDI channel: " + midiProcessor.getChannel() + "\nSystem version: " + osVersion[MAJOR] + "." + osVersion[MINOR]);
     };
-    auto setGroupComponents = [this](String& status, bool midiControlsEnabled, bool programControlsEnabled, bool programSectionOn) {
+    auto setGroupComponents = [this](Status status, bool midiControlsEnabled, bool programControlsEnabled, bool programSectionOn) {
         midiControls.setEnabled(midiControlsEnabled);
         programControls.setEnabled(programControlsEnabled);
         display.toggleProgramSection(programSectionOn ? ON : OFF);
-        disconnectedUnderline.setVisible(status == STATUS_MESSAGES[DISCONNECTED]);
-        sysexDisabledUnderline.setVisible(status == STATUS_MESSAGES[SYSEX_DISABLED]);
+        disconnectedUnderline.setVisible(status == DISCONNECTED);
+        sysexDisabledUnderline.setVisible(status == SYSEX_DISABLED);
     };
 
 
-    if (response.status == STATUS_MESSAGES[CONNECTED]) {
+    // Publish the new state first, so the worker threads and the repaint below already use it
+    if ((response.status == CONNECTED || response.status == SYSEX_DISABLED) && response.model != UNCHANGED && response.model != UNKNOWN)
+        synthState.publish(response.status, static_cast<SynthModel>(response.model), response.supportsHiddenWaves);
+    else
+        synthState.setStatus(response.status);
+
+    const auto currentModel = getCurrentSynthModel();
+
+    if (response.status == CONNECTED) {
 
         if (response.model != UNCHANGED && response.model != UNKNOWN) {
             modelLabel.setText(SYNTH_MODELS[response.model], NO_NOTIF);
@@ -323,25 +1115,29 @@ void MainComponent::updateStatus(DeviceResponse response) {
             osVersion[MINOR] = response.osVersion[MINOR];
         }
 
-        currentModel = getCurrentSynthModel();
-
         if (response.model != UNCHANGED) {
-            // Update the waveforms in the menus
-            for (int osc = 0; osc < 3; osc++)
-                waveMenus[osc].clear(NO_NOTIF);
+            knownSynthMidiIn = midiInMenu.getText();
+            knownSynthMidiOut = midiOutMenu.getText();
+            connectionCache.store(knownSynthMidiIn, knownSynthMidiOut, midiProcessor.getChannel().getIntValue() - 1, response.deviceIdMessage);
 
-            waveMenuOpts = {"WAV0    to    WAV" + String(NB_OF_WAVES[currentModel] - 1)};
             // Add hidden waveforms to the menu if the synth supports them
             if (response.supportsHiddenWaves) {
-                for (int w = NB_OF_WAVES[currentModel]; w < 256; w++)
-                    waveMenuOpts.add("WAV" + String(w));
-
-                for (int osc = 0; osc < 3; osc++) {
-                    waveMenus[osc].addItemList(waveMenuOpts, 1);
-                    waveMenus[osc].setTooltip("Waveform for oscillator " + String(osc + 1) + ":\nThe first option is normal waveforms, the rest are hidden waveforms.");
+                // The menus only need to be updated if the number of waves changed since the last connection
+                if (waveMenusNbOfWaves != NB_OF_WAVES[currentModel]) {
+                    waveMenusNbOfWaves = NB_OF_WAVES[currentModel];
+                    const auto& waveMenuOpts = getWaveMenuOptions(waveMenusNbOfWaves);
+
+                    for (int osc = 0; osc < 3; osc++) {
+                        *waveMenus[osc].getRootMenu() = waveMenuOpts;
+                        display.toggleComponent(waveMenus[osc], ON);
+                        waveMenus[osc].setTooltip("Waveform for oscillator " + String(osc + 1) +
+                                                  ":\nThe first option is normal waveforms, the rest are hidden waveforms.");
+                    }
                 }
             } else {
+                waveMenusNbOfWaves = 0;
                 for (int osc = 0; osc < 3; osc++) {
+                    waveMenus[osc].clear(NO_NOTIF);
                     display.toggleComponent(waveMenus[osc], OFF);
                     waveMenus[osc].setTextWhenNothingSelected("Un5upported");
                     if (currentModel == ESQ1)
@@ -365,101 +1161,121 @@ void MainComponent::updateStatus(DeviceResponse response) {
         }
         selfOscButton.setToggleState(parameterValues.currentSelfOsc, NO_NOTIF);
 
+        if (analyzerSource.load() == ANALYZER_WAVE_PREVIEW)
+            wavePreview.setProgram(response.currentProgram.getSysExData());
+
         updateStatusLabel(STATUS_MESSAGES[CONNECTED] + "    to    ", false);
         setGroupComponents(response.status, true, true, true);
 
-    } else if (response.status == STATUS_MESSAGES[DISCONNECTED]) {
+    } else if (response.status == DISCONNECTED) {
         updateStatusLabel(STATUS_MESSAGES[DISCONNECTED], true);
         programNameLabel.setText("______", NO_NOTIF);
         setGroupComponents(response.status, true, false, false);
-    } else if (response.status == STATUS_MESSAGES[SYSEX_DISABLED]) {
+    } else if (response.status == SYSEX_DISABLED) {
         updateStatusLabel(STATUS_MESSAGES[SYSEX_DISABLED] + "    on    ", false);
         if (response.model != UNCHANGED && response.model != UNKNOWN) {
             modelLabel.setText(SYNTH_MODELS[response.model], NO_NOTIF);
-            currentModel = getCurrentSynthModel();
             if (selectedThemeOption == AUTOMATIC_THEME)
                 repaint();
         }
         setGroupComponents(response.status, true, false, false);
-    } else if (response.status == STATUS_MESSAGES[MODIFYING_PROGRAM] || response.status == STATUS_MESSAGES[REFRESHING]) {
-        updateStatusLabel(response.status, response.status == STATUS_MESSAGES[REFRESHING]);
+    } else if (response.status == MODIFYING_PROGRAM || response.status == REFRESHING) {
+        updateStatusLabel(STATUS_MESSAGES[response.status], response.status == REFRESHING);
         setGroupComponents(response.status, false, false, false);
     }
 
     updateModelLabel(response);
 }
 
-void MainComponent::attemptConnection() {
+void MainComponent::attemptConnection(std::function<void()> onFinished) {
     if (midiInMenu.getSelectedItemIndex() > 0 && midiOutMenu.getSelectedItemIndex() > 0) {
-        updateStatus(DeviceResponse(STATUS_MESSAGES[REFRESHING], NO_PROG));
-        Thread::launch([this] {
-            auto response = midiProcessor.requestDeviceInquiry();
-            MessageManager::callAsync([this, response] { updateStatus(response); });
+        updateStatus(DeviceResponse(REFRESHING, NO_PROG));
+        Thread::launch([this, onFinished, midiInName = midiInMenu.getText(), midiOutName = midiOutMenu.getText()] {
+            // A synth we already know on these ports only needs a quick check, the full discovery is only done when it doesn't answer
+            ConnectionCache::KnownSynth knownSynth;
+            auto response = connectionCache.find(midiInName, midiOutName, knownSynth) ? midiProcessor.verifyKnownSynth(knownSynth.channel, knownSynth.deviceIdMessage)
+                                                                                     : midiProcessor.requestDeviceInquiry();
+            MessageManager::callAsync([this, onFinished, response, midiInName, midiOutName] {
+                if (response.status == DISCONNECTED)
+                    connectionCache.forget(midiInName, midiOutName);
+                updateStatus(response);
+                if (onFinished)
+                    onFinished();
+            });
         });
-    } else
-        updateStatus(DeviceResponse(STATUS_MESSAGES[DISCONNECTED], NO_PROG));
+    } else {
+        updateStatus(DeviceResponse(DISCONNECTED, NO_PROG));
+        if (onFinished)
+            onFinished();
+    }
 }
 
 void MainComponent::refreshMidiDevices(bool allowMenuSwitch) {
-    midiInDeviceNames.clear();
-    midiOutDeviceNames.clear();
-    // Check for MIDI input devices and populate the combo box
-    for (auto& device : MidiInput::getAvailableDevices()) {
-        if (!ignoredMidiDevices.contains(device.name))
-            midiInDeviceNames.add(device.name);
-    }
+    auto refreshMenu = [this, allowMenuSwitch](ComboBox& menu, const StringArray& deviceNames, const String& knownSynthDevice) {
+        String currentDevice = menu.getText();
+        menu.clear(NO_NOTIF);
+        menu.addItem("None", 1);
+        menu.addItemList(deviceNames, 2);
+        if (deviceNames.contains(currentDevice) && currentDevice != "None")
+            // Select the previously selected MIDI device if it's still available
+            menu.setSelectedItemIndex(deviceNames.indexOf(currentDevice) + 1, NO_NOTIF);
+        else if (knownSynthDevice.isNotEmpty() && deviceNames.contains(knownSynthDevice))
+            // The port of the last synth we connected to came back, so we reconnect to it
+            menu.setSelectedItemIndex(deviceNames.indexOf(knownSynthDevice) + 1, sendNotification);
+        else
+            // Select the first device in the list if the previously selected device is not available,
+            // or None if no devices are available or we don't change the context menu value
+            menu.setSelectedItemIndex(allowMenuSwitch && deviceNames.size() > 0 ? 1 : 0, sendNotification);
+    };
 
-    String currentDevice = midiInMenu.getText();
-    midiInMenu.clear(NO_NOTIF);
-    midiInMenu.addItem("None", 1);
-    midiInMenu.addItemList(midiInDeviceNames, 2);
-    if (midiInDeviceNames.contains(currentDevice) && currentDevice != "None")
-        // Select the previously selected MIDI input device if it's still available
-        midiInMenu.setSelectedItemIndex(midiInDeviceNames.indexOf(currentDevice) + 1, NO_NOTIF);
-    else
-        // Select the first device in the list if the previously selected device is not available,
-        // or None if no input devices are available or we don't change the context menu value
-        midiInMenu.setSelectedItemIndex(allowMenuSwitch && midiInDeviceNames.size() > 0 ? 1 : 0, sendNotification);
-
-    // Check for MIDI output devices and populate the combo box
-    for (auto& device : MidiOutput::getAvailableDevices()) {
-        if (!ignoredMidiDevices.contains(device.name))
-            midiOutDeviceNames.add(device.name);
-    }
-    currentDevice = midiOutMenu.getText();
-    midiOutMenu.clear(NO_NOTIF);
-    midiOutMenu.addItem("None", 1);
-    midiOutMenu.addItemList(midiOutDeviceNames, 2);
-    if (midiOutDeviceNames.contains(currentDevice) && currentDevice != "None")
-        // Same thing but for the output device.
-        midiOutMenu.setSelectedItemIndex(midiOutDeviceNames.indexOf(currentDevice) + 1, NO_NOTIF);
-    else
-        midiOutMenu.setSelectedItemIndex(allowMenuSwitch && midiOutDeviceNames.size() > 0 ? 1 : 0, sendNotification);
+    refreshMenu(midiInMenu, midiInDeviceNames, knownSynthMidiIn);
+    refreshMenu(midiOutMenu, midiOutDeviceNames, knownSynthMidiOut);
 }
 
 void MainComponent::timerCallback() {
     // Blink the underline on status errors
-    if (statusLabel.getText() == STATUS_MESSAGES[DISCONNECTED])
+    if (synthState.getStatus() == DISCONNECTED)
         disconnectedUnderline.setVisible(!disconnectedUnderline.isVisible());
-    else if (statusLabel.getText().startsWith(STATUS_MESSAGES[SYSEX_DISABLED]))
+    else if (synthState.getStatus() == SYSEX_DISABLED)
         sysexDisabledUnderline.setVisible(!sysexDisabledUnderline.isVisible());
+
+    AudioAnalyzer::Result result;
+    if (analyzerSource.load() != ANALYZER_OFF && audioAnalyzer.popResult(result)) {
+        if (result.fundamentalHz <= 0.0f)
+            analyzerLabel.setText("---", NO_NOTIF);
+        else {
+            // LF range pitches can go below the lowest MIDI note, only the frequency is shown for those
+            const auto noteNumber = roundToInt(69.0 + 12.0 * std::log2(result.fundamentalHz / 440.0));
+            const auto noteName = isPositiveAndBelow(noteNumber, 128) ? "    " + MidiMessage::getMidiNoteName(noteNumber, true, true, 4) : String();
+            // The preview plays a guess of the wave, not the synth
+            const auto prefix = analyzerSource.load() == ANALYZER_WAVE_PREVIEW ? String("Preview ~ ") : String();
+            analyzerLabel.setText(prefix + String(result.fundamentalHz, 1) + " Hz" + noteName, NO_NOTIF);
+        }
+
+        if (captureMode != NO_CAPTURE) {
+            capturedResults.add(result);
+            if (capturedResults.size() >= CAPTURE_LENGTH) {
+                if (captureMode == CAPTURE_QUERY)
+                    showSimilarWaves(capturedResults);
+                else if (fingerprintIndex.addRecording(capturedWave, capturedOctave, capturedResults))
+                    fingerprintIndex.save();
+                else
+                    AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "SideQick", "Nothing was heard on the audio input, the wave was not captured");
+                captureMode = NO_CAPTURE;
+            }
+        }
+    }
 }
 
-SynthModel MainComponent::getCurrentSynthModel() const {
-    // Yes, I use the label text to keep track of the current synth model. This is really hacky but
-    // it works for now with multithreading. PRs are welcome :)
-    if (modelLabel.getText() == SYNTH_MODELS[SQ80])
-        return SQ80;
-    else if (modelLabel.getText() == SYNTH_MODELS[ESQ1])
-        return ESQ1;
-    else if (modelLabel.getText() == SYNTH_MODELS[ESQM])
-        return ESQM;
-    else if (modelLabel.getText() == SYNTH_MODELS[SQ80M])
-        return SQ80M;
-    else
-        return UNKNOWN;
+void MainComponent::startupStageDone(const String& stageName) {
+    auto& profiler = StartupProfiler::getInstance();
+    profiler.mark(stageName);
+    if (--nbOfPendingStartupStages == 0)
+        profiler.finish();
 }
 
+SynthModel MainComponent::getCurrentSynthModel() const { return synthState.getModel(); }
+
 void MainComponent::createLabel(Label& label, Component& parent, const String& text, const int x, const int y, const int width, const int height, const Colour& colour,
                                 const Font& font) {
     label.setBounds(x, y, width, height);
@@ -471,7 +1287,7 @@ void MainComponent::createLabel(Label& label, Component& parent, const String& t
 }
 
 void MainComponent::createComboBox(ComboBox& comboBox, Component& parent, const int x, const int y, const int width, const int height, const String& tooltip,
-                                   const std::function<DeviceResponse()>& onChangeFunc, const StringArray& items) {
+                                   const std::function<DeviceResponse(MidiSysexProcessor&)>& onChangeFunc, const StringArray& items) {
     comboBox.addItemList(items, 1);
     comboBox.setSelectedItemIndex(0, NO_NOTIF);
     comboBox.setBounds(x, y, width, height);
@@ -482,17 +1298,55 @@ void MainComponent::createComboBox(ComboBox& comboBox, Component& parent, const
 }
 
 void MainComponent::createToggleButton(ToggleButton& button, Component& parent, const int x, const int y, const int width, const int height, const String& tooltip,
-                                       const std::function<DeviceResponse()>& onClickFunc) {
+                                       const std::function<DeviceResponse(MidiSysexProcessor&)>& onClickFunc) {
     button.setBounds(x, y, width, height);
     button.setTooltip(tooltip);
     parent.addAndMakeVisible(button);
     button.onClick = [this, onClickFunc] { displayControlOnChange(onClickFunc); };
 }
 
-void MainComponent::displayControlOnChange(const std::function<DeviceResponse()>& onChangeFunc) {
-    updateStatus(DeviceResponse(STATUS_MESSAGES[MODIFYING_PROGRAM], NO_PROG));
+void MainComponent::applyToLinkedUnits(const SynthSessionManager::SessionEdit& edit) {
+    sessionManager.applyToAll(edit, [](int nbOfFailures, const StringArray& skippedUnits) {
+        String problems;
+        if (nbOfFailures > 0)
+            problems << nbOfFailures << " linked unit(s) did not respond to the last edit\n\n";
+        if (!skippedUnits.isEmpty())
+            problems << "The last edit can't be made on these linked units, they were left alone:\n\n" << skippedUnits.joinIntoString("\n");
+        if (problems.isNotEmpty())
+            AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "SideQick", problems.trimEnd());
+    });
+}
+
+void MainComponent::displayControlOnChange(const std::function<DeviceResponse(MidiSysexProcessor&)>& onChangeFunc) {
+    updateStatus(DeviceResponse(MODIFYING_PROGRAM, NO_PROG));
+
+    // When linked, the same edit is applied in parallel to every other unit found by the session manager
+    if (linkedEditing)
+        applyToLinkedUnits([onChangeFunc](SynthSession& session) -> std::optional<DeviceResponse> { return onChangeFunc(session.processor); });
+
     Thread::launch([this, &onChangeFunc] {
-        DeviceResponse status = onChangeFunc();
+        DeviceResponse status = onChangeFunc(midiProcessor);
+        MessageManager::callAsync([this, status] { updateStatus(status); });
+    });
+}
+
+void MainComponent::changeWaveOnAllUnits(const int osc, const int wave, const SynthModel model) {
+    updateStatus(DeviceResponse(MODIFYING_PROGRAM, NO_PROG));
+
+    if (linkedEditing) {
+        applyToLinkedUnits([this, osc, wave, model](SynthSession& session) -> std::optional<DeviceResponse> {
+            const auto unitModel = session.processor.synthState.getModel();
+            if (unitModel == UNKNOWN || unitModel == UNCHANGED)
+                return std::nullopt;
+            const auto unitWave = waveTranslator.translate(model, unitModel, wave);
+            if (unitWave == WaveTranslator::NO_EQUIVALENT || !session.processor.synthState.canPlayWave(unitWave))
+                return std::nullopt;
+            return session.processor.changeOscWaveform(osc, unitWave);
+        });
+    }
+
+    Thread::launch([this, osc, wave] {
+        DeviceResponse status = midiProcessor.changeOscWaveform(osc, wave);
         MessageManager::callAsync([this, status] { updateStatus(status); });
     });
 }
@@ -14,22 +14,44 @@
 
 #pragma once
 
+#include "AudioAnalyzer.h"
+#include "ConnectionCache.h"
+#include "ControlServer.h"
+#include "DiskImage.h"
 #include "Display.h"
 #include "Logo.h"
+#include "MidiCcMapper.h"
+#include "MidiDeviceMonitor.h"
+#include "MidiDeviceTransport.h"
 #include "MidiSysexProcessor.h"
 #include "PannelButton.h"
+#include "ParameterSequencer.h"
+#include "ProgramLibrary.h"
+#include "ProgramScript.h"
+#include "ProgramSimilarityIndex.h"
+#include "SynthSessionManager.h"
+#include "WaveFingerprintIndex.h"
+#include "WavePreviewEngine.h"
+#include "WaveTranslator.h"
 #include <JuceHeader.h>
 
 using namespace juce;
 
 class PlasticTexture : public Component {
   public:
-    PlasticTexture(const Image& textureImage);
+    PlasticTexture(const Image& textureImage = {});
+
+    void setSourceImage(const Image& textureImage);
 
     void paint(Graphics& g) override;
     void resized() override;
 
   private:
+    const float TEXTURE_OPACITY = 0.13f;
+
+    // The source image is kept so that the texture is always rescaled from the original
+    juce::Image sourceImage;
+    // Rescaled with the opacity already applied, so painting it is a plain blit
     juce::Image textureImage;
     std::unique_ptr<PlasticTexture> overlayComponent;
 };
@@ -44,10 +66,14 @@ class MainComponent : public AudioAppComponent, public MidiInputCallback, public
   private:
     void handleIncomingMidiMessage(MidiInput* source, const MidiMessage& message) override;
     void updateStatus(DeviceResponse response);
-    void attemptConnection();
+    // onFinished is called on the message thread once the new status is shown and published
+    void attemptConnection(std::function<void()> onFinished = nullptr);
     void refreshMidiDevices(bool allowMenuSwitch = false);
     void timerCallback() override;
     SynthModel getCurrentSynthModel() const;
+    unsigned int getThemeColourIndex() const;
+    void renderBackgroundCache(unsigned int themeColourIndex, float scale);
+    void startupStageDone(const String& stageName);
     //==============================================================================
     void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
     void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
@@ -58,17 +84,43 @@ class MainComponent : public AudioAppComponent, public MidiInputCallback, public
     void resized() override;
 
     void showContextMenu();
+    void discoverOtherUnits();
+    void startSequencer(const Array<ParameterSequencer::Step>& steps);
+    void stopSequencer();
+    void saveMidiRecording();
+    void replayMidiRecording(double speed);
+    void startAudioInputAnalysis();
+    void startAudioFileAnalysis();
+    void stopAudioAnalysis();
+    void loadWaveRom();
+    void startWavePreview();
+    void importWaveRecordings();
+    void findWavesLikeAudioFile();
+    void showSimilarWaves(const Array<AudioAnalyzer::Result>& results);
+    void loadProgramScript();
+    void runScriptOnCurrentProgram();
+    void runScriptOnBankFile();
+    void addLibraryFolder();
+    void showLibraryMatches(const String& description, const ProgramLibrary::Query& query);
+    void showProgramsLikeCurrent();
+    void uploadBankFile();
+    void convertBankFile(SynthModel from, SynthModel to);
+    void importWaveEquivalences();
+    void extractDiskImage();
     void mouseDown(const juce::MouseEvent& event) override;
 
     void createLabel(Label& label, Component& parent, const String& text, const int x, const int y, const int width, const int height, const Colour& colour = Colour(),
                      const Font& font = Font(Font::getDefaultSansSerifFontName(), 16.0f, Font::plain));
 
     void createComboBox(ComboBox& comboBox, Component& parent, const int x, const int y, const int width, const int height, const String& tooltip,
-                        const std::function<DeviceResponse()>& onChangeFunc, const StringArray& items = {});
-    void displayControlOnChange(const std::function<DeviceResponse()>& onChangeFunc);
+                        const std::function<DeviceResponse(MidiSysexProcessor&)>& onChangeFunc, const StringArray& items = {});
+    void displayControlOnChange(const std::function<DeviceResponse(MidiSysexProcessor&)>& onChangeFunc);
+    void applyToLinkedUnits(const SynthSessionManager::SessionEdit& edit);
+    // The wave is numbered on the main unit's model, and translated for each linked unit
+    void changeWaveOnAllUnits(int osc, int wave, SynthModel model);
 
     void createToggleButton(ToggleButton& button, Component& parent, const int x, const int y, const int width, const int height, const String& tooltip,
-                            const std::function<DeviceResponse()>& onClickFunc);
+                            const std::function<DeviceResponse(MidiSysexProcessor&)>& onClickFunc);
 
     unsigned int windowWidth = 830;
     unsigned int windowHeight = 410;
@@ -87,11 +139,62 @@ class MainComponent : public AudioAppComponent, public MidiInputCallback, public
     const StringArray THEME_OPTIONS = {"Automatic", "SQ-80", "ESQ-1", "Neutral"};
     unsigned int selectedThemeOption = AUTOMATIC_THEME;
 
-    MidiSysexProcessor midiProcessor;
+    MidiDeviceTransport midiTransport;
+    MidiSysexProcessor midiProcessor{midiTransport};
+    SynthState& synthState = midiProcessor.synthState;
+    MidiCcMapper ccMapper{midiProcessor};
+    ParameterSequencer sequencer{midiProcessor};
+    double sequencerBpm = 120.0;
+    bool sequencerSyncedToClock = false;
+    const int SEQUENCER_STEPS_PER_BEAT = 2;
+    // The other units connected to the computer, which can follow the edits made on the main one
+    SynthSessionManager sessionManager;
+    bool linkedEditing = false;
+    // Lets other tools on this computer drive the edits
+    ControlServer controlServer{midiProcessor};
+    std::unique_ptr<MidiTrafficReplayer> trafficReplayer;
+    std::unique_ptr<FileChooser> fileChooser;
     const StringArray ignoredMidiDevices = {"Microsoft GS Wavetable Synth"};
+    MidiDeviceMonitor deviceMonitor;
+    bool initialDeviceScanDone = false;
+    // The texture, the logo and the first MIDI device scan are loaded in the background while the window is already showing
+    int nbOfPendingStartupStages = 3;
+    // Ports of the last synth we connected to, so we can reconnect automatically when they come back
+    String knownSynthMidiIn;
+    String knownSynthMidiOut;
+    // The synths found on each port pair in previous sessions, to reconnect with a single round-trip
+    ConnectionCache connectionCache;
+
+    // The audio callbacks feed the synth's output, or a file or the wave preview playing in its place, to the analyzer
+    enum AnalyzerSources { ANALYZER_OFF, ANALYZER_AUDIO_INPUT, ANALYZER_AUDIO_FILE, ANALYZER_WAVE_PREVIEW };
+    std::atomic<int> analyzerSource{ANALYZER_OFF};
+    AudioAnalyzer audioAnalyzer;
+    AudioFormatManager audioFormatManager;
+    TimeSliceThread audioFileReadThread{"Audio file reader"};
+    std::unique_ptr<AudioFormatReaderSource> audioFileSource;
+    AudioTransportSource audioFileTransport;
+    // While previewing, the waveform menus only change what the preview plays and nothing is sent to the synth
+    WavePreviewEngine wavePreview;
+
+    WaveFingerprintIndex fingerprintIndex{File::getSpecialLocation(File::userApplicationDataDirectory).getChildFile("SideQick").getChildFile("WaveFingerprints.sqkf")};
+    // Live captures collect the analyzer results for a few seconds, to fingerprint the current wave or to search for it
+    enum CaptureModes { NO_CAPTURE, CAPTURE_FINGERPRINT, CAPTURE_QUERY };
+    CaptureModes captureMode = NO_CAPTURE;
+    Array<AudioAnalyzer::Result> capturedResults;
+    int capturedWave = 0;
+    int capturedOctave = 0;
+    const int CAPTURE_LENGTH = 8;
+
+    // User transforms, applied to the current program or to a whole bank file
+    ProgramScript programScript;
+    String programScriptName;
+    // Programs from .syx libraries, searchable by their illegal values
+    ProgramLibrary programLibrary;
+    // Rebuilt in the background every time programs are added to the library
+    ProgramSimilarityIndex similarityIndex;
+    // Wave equivalences between the models, for the bank conversions
+    WaveTranslator waveTranslator{File::getSpecialLocation(File::userApplicationDataDirectory).getChildFile("SideQick").getChildFile("WaveEquivalences.txt")};
 
-
-    SynthModel currentModel;
     String osVersion[2];
     enum Oscillators { OSC1, OSC2, OSC3 };
 
@@ -122,6 +225,11 @@ class MainComponent : public AudioAppComponent, public MidiInputCallback, public
 
     const float separatorThickness = 10.0f;
 
+    // The static background layers are rendered once per theme and scale, then composited on each repaint
+    Image backgroundCache;
+    unsigned int backgroundCacheTheme = 0;
+    float backgroundCacheScale = 0.0f;
+
     StringArray midiInDeviceNames;
     StringArray midiOutDeviceNames;
 
@@ -144,6 +252,10 @@ class MainComponent : public AudioAppComponent, public MidiInputCallback, public
     unsigned int modelLabelXPos = 650;
     Label disconnectedUnderline;
     Label sysexDisabledUnderline;
+    Label analyzerLabel;
+    // Shown in place of the analyzer while a bank is sent to the synth
+    double bankUploadProgress = 0.0;
+    ProgressBar bankUploadBar{bankUploadProgress};
 
     PannelButton refreshButton;
 
@@ -166,7 +278,8 @@ class MainComponent : public AudioAppComponent, public MidiInputCallback, public
     // The top row of the display
     GroupComponent statusSection;
 
-    StringArray waveMenuOpts;
+    // Number of normal waves the waveform menus were last filled for, 0 if they are empty
+    unsigned int waveMenusNbOfWaves = 0;
     ComboBox waveMenus[3];
     ComboBox octMenus[3];
     ComboBox semiMenus[3];
@@ -0,0 +1,122 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#include "MidiCcMapper.h"
+#include "ProgramParser.h"
+
+using namespace juce;
+
+const StringArray MidiCcMapper::TARGET_NAMES = {"OSC 1 waveform", "OSC 2 waveform", "OSC 3 waveform", "OSC 1 octave", "OSC 2 octave",
+                                                "OSC 3 octave",   "OSC 1 LF mode",  "OSC 2 LF mode",  "OSC 3 LF mode", "Filter self-osc"};
+
+MidiCcMapper::MidiCcMapper(MidiSysexProcessor& processor) : Thread("MIDI CC mapper"), processor(processor) {
+    for (int target = 0; target < NB_OF_TARGETS; target++) {
+        controllerNumbers[target].store(DEFAULT_CONTROLLERS[target]);
+        pendingValues[target].store(NO_VALUE);
+    }
+}
+
+MidiCcMapper::~MidiCcMapper() { stopThread(2000); }
+
+void MidiCcMapper::setEnabled(bool shouldBeEnabled) {
+    enabled.store(shouldBeEnabled);
+    if (shouldBeEnabled)
+        startThread(Priority::high);
+    else
+        stopThread(2000);
+}
+
+void MidiCcMapper::setControllerNumber(Target target, int controllerNumber) { controllerNumbers[target].store(controllerNumber); }
+
+bool MidiCcMapper::handleControllerMessage(const MidiMessage& message) {
+    if (!enabled.load(std::memory_order_relaxed) || !message.isController())
+        return false;
+
+    const auto controllerNumber = message.getControllerNumber();
+    for (int target = 0; target < NB_OF_TARGETS; target++) {
+        if (controllerNumbers[target].load(std::memory_order_relaxed) == controllerNumber) {
+            // The newest value always wins, older ones that were not sent yet are simply overwritten
+            pendingValues[target].store(message.getControllerValue(), std::memory_order_release);
+            notify();
+            return true;
+        }
+    }
+    return false;
+}
+
+void MidiCcMapper::run() {
+    double lastSendTime = 0.0;
+
+    while (!threadShouldExit()) {
+        wait(-1);
+
+        // Don't send faster than the synth can receive programs. Values keep being updated while we wait.
+        for (auto remaining = lastSendTime + processor.getProgramSendTimeMs() - Time::getMillisecondCounterHiRes(); remaining > 0;
+             remaining = lastSendTime + processor.getProgramSendTimeMs() - Time::getMillisecondCounterHiRes()) {
+            if (threadShouldExit())
+                return;
+            wait(static_cast<int>(std::ceil(remaining)));
+        }
+
+        int values[NB_OF_TARGETS];
+        bool hasPendingValues = false;
+        for (int target = 0; target < NB_OF_TARGETS; target++) {
+            values[target] = pendingValues[target].exchange(NO_VALUE, std::memory_order_acquire);
+            hasPendingValues |= values[target] != NO_VALUE;
+        }
+
+        if (!hasPendingValues || processor.synthState.getStatus() != CONNECTED)
+            continue;
+
+        // Everything received since the last send goes into a single program
+        const auto model = processor.synthState.getModel();
+        auto response = processor.editProgram(
+            [this, &values, model](uint8_t* progData) {
+                for (int target = 0; target < NB_OF_TARGETS; target++)
+                    if (values[target] != NO_VALUE)
+                        applyValue(progData, static_cast<Target>(target), values[target], model);
+            },
+            MidiSysexProcessor::FROM_CACHE);
+        lastSendTime = Time::getMillisecondCounterHiRes();
+
+        if (onProgramSent)
+            onProgramSent(response);
+    }
+}
+
+void MidiCcMapper::applyValue(uint8_t* progData, Target target, int value, SynthModel model) const {
+    const bool switchedOn = value >= 64;
+
+    if (target <= WAVE_OSC3) {
+        // The ESQ-M and the older ESQ-1s can't play hidden waves, and we can't place the range without knowing the model
+        if (model == ESQM || model >= UNKNOWN || !processor.synthState.supportsHiddenWaves())
+            return;
+        // 0 is the normal waveforms option, the rest of the controller range is spread over the hidden waves
+        const int lastNormalWave = NB_OF_WAVES[model] - 1;
+        const int waveIndex = lastNormalWave + roundToInt(value * (255 - lastNormalWave) / 127.0);
+        ProgramParser::setNibblePair(progData, ProgramParser::WAVE[target - WAVE_OSC1], waveIndex);
+
+    } else if (target <= OCT_OSC3) {
+        const int osc = target - OCT_OSC1;
+        // Thirds of the controller range select the normal range, OCT+6 and OCT+7, keeping the current semitone
+        const int currentOctave = ProgramParser::getNibblePair(progData, ProgramParser::PITCH[osc]) / 12 - 3;
+        ProgramParser::setOctave(progData, osc, value < 43 ? jmin(currentOctave, 5) : (value < 85 ? 6 : 7));
+
+    } else if (target <= LF_OSC3) {
+        ProgramParser::setLowFrequencyRange(progData, target - LF_OSC1, switchedOn);
+
+    } else if (target == SELF_OSC) {
+        ProgramParser::setSelfOscillation(progData, switchedOn);
+    }
+}
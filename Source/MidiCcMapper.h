@@ -0,0 +1,59 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#pragma once
+
+#include "MidiSysexProcessor.h"
+#include <JuceHeader.h>
+#include <atomic>
+
+using namespace juce;
+
+// Maps incoming MIDI controllers to the illegal-range parameters. The MIDI thread only stores the newest value of each
+// controller, and a worker thread folds everything received since the last send into a single program edit, sent
+// no faster than the synth can take them. Edits are made on the cached program, so there is no dump request per move.
+class MidiCcMapper : private Thread {
+  public:
+    enum Target { WAVE_OSC1, WAVE_OSC2, WAVE_OSC3, OCT_OSC1, OCT_OSC2, OCT_OSC3, LF_OSC1, LF_OSC2, LF_OSC3, SELF_OSC, NB_OF_TARGETS };
+    static const StringArray TARGET_NAMES;
+
+    MidiCcMapper(MidiSysexProcessor& processor);
+    ~MidiCcMapper() override;
+
+    void setEnabled(bool shouldBeEnabled);
+    bool isEnabled() const { return enabled.load(); }
+    void setControllerNumber(Target target, int controllerNumber);
+    int getControllerNumber(Target target) const { return controllerNumbers[target].load(); }
+
+    // Called from the MIDI thread. Returns true if the message was a mapped controller, in which case it was consumed.
+    bool handleControllerMessage(const MidiMessage& message);
+
+    // Called from the worker thread after each program sent
+    std::function<void(const DeviceResponse& response)> onProgramSent;
+
+  private:
+    void run() override;
+    void applyValue(uint8_t* progData, Target target, int value, SynthModel model) const;
+
+    MidiSysexProcessor& processor;
+    std::atomic<bool> enabled{false};
+    std::atomic<int> controllerNumbers[NB_OF_TARGETS];
+    // Newest value received for each target, or NO_VALUE if nothing is pending
+    std::atomic<int> pendingValues[NB_OF_TARGETS];
+    static const int NO_VALUE = -1;
+    // Undefined controllers in the MIDI specification, so they don't clash with anything on the synth
+    static constexpr int DEFAULT_CONTROLLERS[NB_OF_TARGETS] = {20, 21, 22, 23, 24, 25, 26, 27, 28, 29};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiCcMapper)
+};
@@ -0,0 +1,182 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#include "MidiDeviceMonitor.h"
+
+using namespace juce;
+
+MidiDeviceMonitor::MidiDeviceMonitor(MidiInputCallback& inputCallback, const StringArray& ignoredDevices)
+    : Thread("MIDI device monitor"), inputCallback(inputCallback), ignoredDevices(ignoredDevices),
+      deviceListConnection(MidiDeviceListConnection::make([this] { rescan(); })) {
+    selfReference = this;
+    startThread();
+}
+
+MidiDeviceMonitor::~MidiDeviceMonitor() {
+    stopThread(2000);
+
+    // Anything left to close is closed here, since the background thread is gone
+    for (auto& device : inputsToClose)
+        device->stop();
+}
+
+void MidiDeviceMonitor::rescan() {
+    rescanPending.store(true);
+    notify();
+}
+
+void MidiDeviceMonitor::openInput(const String& name) {
+    {
+        const ScopedLock sl(requestLock);
+        inputRequested = true;
+        requestedInputName = name;
+    }
+    notify();
+}
+
+void MidiDeviceMonitor::openOutput(const String& name) {
+    {
+        const ScopedLock sl(requestLock);
+        outputRequested = true;
+        requestedOutputName = name;
+    }
+    notify();
+}
+
+void MidiDeviceMonitor::closeInput(std::unique_ptr<MidiInput> device) {
+    if (device == nullptr)
+        return;
+    {
+        const ScopedLock sl(requestLock);
+        inputsToClose.push_back(std::move(device));
+    }
+    notify();
+}
+
+void MidiDeviceMonitor::closeOutput(std::unique_ptr<MidiOutput> device) {
+    if (device == nullptr)
+        return;
+    {
+        const ScopedLock sl(requestLock);
+        outputsToClose.push_back(std::move(device));
+    }
+    notify();
+}
+
+void MidiDeviceMonitor::run() {
+    while (!threadShouldExit()) {
+        // The device lists are scanned before opening anything, since a requested device may have just appeared
+        if (rescanPending.exchange(false))
+            scanDevices();
+
+        bool openIn, openOut;
+        String inName, outName;
+        std::vector<std::unique_ptr<MidiInput>> closingInputs;
+        std::vector<std::unique_ptr<MidiOutput>> closingOutputs;
+        {
+            const ScopedLock sl(requestLock);
+            openIn = std::exchange(inputRequested, false);
+            openOut = std::exchange(outputRequested, false);
+            inName = requestedInputName;
+            outName = requestedOutputName;
+            closingInputs.swap(inputsToClose);
+            closingOutputs.swap(outputsToClose);
+        }
+
+        for (auto& device : closingInputs)
+            device->stop();
+        closingInputs.clear();
+        closingOutputs.clear();
+
+        if (openIn) {
+            std::unique_ptr<MidiInput> device;
+            for (auto& info : inputDevices) {
+                if (info.name == inName) {
+                    device = MidiInput::openDevice(info.identifier, &inputCallback);
+                    if (device != nullptr)
+                        device->start();
+                    break;
+                }
+            }
+            // Shared with the callback, so the device is still deleted if the callback never gets to take it
+            auto openedDevice = std::make_shared<std::unique_ptr<MidiInput>>(std::move(device));
+            callOnMessageThread([openedDevice](MidiDeviceMonitor& monitor) {
+                if (monitor.onInputOpened)
+                    monitor.onInputOpened(std::move(*openedDevice));
+            });
+        }
+
+        if (openOut) {
+            std::unique_ptr<MidiOutput> device;
+            for (auto& info : outputDevices) {
+                if (info.name == outName) {
+                    device = MidiOutput::openDevice(info.identifier);
+                    break;
+                }
+            }
+            auto openedDevice = std::make_shared<std::unique_ptr<MidiOutput>>(std::move(device));
+            callOnMessageThread([openedDevice](MidiDeviceMonitor& monitor) {
+                if (monitor.onOutputOpened)
+                    monitor.onOutputOpened(std::move(*openedDevice));
+            });
+        }
+
+        // Opening the input and the output of a synth ends in a single connection attempt
+        if (openIn || openOut) {
+            bool openPending;
+            {
+                const ScopedLock sl(requestLock);
+                openPending = inputRequested || outputRequested;
+            }
+            if (!openPending)
+                callOnMessageThread([](MidiDeviceMonitor& monitor) {
+                    if (monitor.onDevicesSettled)
+                        monitor.onDevicesSettled();
+                });
+        }
+
+        wait(-1);
+    }
+}
+
+void MidiDeviceMonitor::scanDevices() {
+    inputDevices.clear();
+    outputDevices.clear();
+    StringArray inputNames, outputNames;
+
+    for (auto& device : MidiInput::getAvailableDevices()) {
+        if (!ignoredDevices.contains(device.name)) {
+            inputDevices.add(device);
+            inputNames.add(device.name);
+        }
+    }
+    for (auto& device : MidiOutput::getAvailableDevices()) {
+        if (!ignoredDevices.contains(device.name)) {
+            outputDevices.add(device);
+            outputNames.add(device.name);
+        }
+    }
+
+    callOnMessageThread([inputNames, outputNames](MidiDeviceMonitor& monitor) {
+        if (monitor.onDevicesChanged)
+            monitor.onDevicesChanged(inputNames, outputNames);
+    });
+}
+
+void MidiDeviceMonitor::callOnMessageThread(std::function<void(MidiDeviceMonitor&)> callback) {
+    MessageManager::callAsync([monitor = selfReference, callback] {
+        if (monitor != nullptr)
+            callback(*monitor.get());
+    });
+}
@@ -0,0 +1,71 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+using namespace juce;
+
+// Watches for MIDI ports being plugged or unplugged, and enumerates, opens and closes devices on a background thread
+// so the message thread never waits on the MIDI drivers. All the callbacks are called on the message thread.
+class MidiDeviceMonitor : private Thread {
+  public:
+    MidiDeviceMonitor(MidiInputCallback& inputCallback, const StringArray& ignoredDevices);
+    ~MidiDeviceMonitor() override;
+
+    std::function<void(const StringArray& inputNames, const StringArray& outputNames)> onDevicesChanged;
+    // The device is nullptr if it could not be opened or if "None" was requested
+    std::function<void(std::unique_ptr<MidiInput> device)> onInputOpened;
+    std::function<void(std::unique_ptr<MidiOutput> device)> onOutputOpened;
+    // Called after the opened devices were handed over, once no other open request is waiting
+    std::function<void()> onDevicesSettled;
+
+    void rescan();
+    // Open a device from its name, replacing the one currently opened for that direction
+    void openInput(const String& name);
+    void openOutput(const String& name);
+    // Devices handed back here are closed on the background thread
+    void closeInput(std::unique_ptr<MidiInput> device);
+    void closeOutput(std::unique_ptr<MidiOutput> device);
+
+  private:
+    void run() override;
+    void scanDevices();
+    // Runs on the message thread, unless the monitor was deleted in the meantime
+    void callOnMessageThread(std::function<void(MidiDeviceMonitor&)> callback);
+
+    MidiInputCallback& inputCallback;
+    const StringArray ignoredDevices;
+    MidiDeviceListConnection deviceListConnection;
+
+    std::atomic<bool> rescanPending{false};
+    Array<MidiDeviceInfo> inputDevices;
+    Array<MidiDeviceInfo> outputDevices;
+
+    CriticalSection requestLock;
+    bool inputRequested = false;
+    bool outputRequested = false;
+    String requestedInputName;
+    String requestedOutputName;
+    std::vector<std::unique_ptr<MidiInput>> inputsToClose;
+    std::vector<std::unique_ptr<MidiOutput>> outputsToClose;
+
+    // Made on the message thread before the background thread starts, which only copies it
+    WeakReference<MidiDeviceMonitor> selfReference;
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE(MidiDeviceMonitor)
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiDeviceMonitor)
+};
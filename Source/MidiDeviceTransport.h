@@ -0,0 +1,33 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#pragma once
+
+#include "MidiTransport.h"
+#include <JuceHeader.h>
+
+using namespace juce;
+
+// The MIDI ports selected in the app, the processor sends to the output and the input callback feeds it the answers
+class MidiDeviceTransport : public MidiTransport {
+  public:
+    std::unique_ptr<MidiInput> input;
+    std::unique_ptr<MidiOutput> output;
+
+    bool isOpen() const override { return output != nullptr; }
+    void send(const MidiMessage& message) override {
+        if (output != nullptr)
+            output->sendMessageNow(message);
+    }
+};
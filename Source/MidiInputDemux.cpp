@@ -0,0 +1,69 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#include "MidiInputDemux.h"
+
+using namespace juce;
+
+MidiInputDemux::Route MidiInputDemux::route(const MidiMessage& message) {
+    const auto* raw = message.getRawData();
+    const auto rawSize = message.getRawDataSize();
+
+    // The bulk of the traffic on a busy rig stops here
+    if (rawSize < 6 || raw[0] != 0xF0)
+        return NOT_ROUTED;
+
+    // Same as getSysExData(): the header and footer are left out
+    const auto* data = raw + 1;
+    const auto dataSize = rawSize - 2;
+
+    Route destination = NOT_ROUTED;
+    // Program dump: 0F 02 channel 01
+    if (dataSize == PROG_DATA_SIZE && data[0] == 0x0F && data[1] == 0x02 && data[3] == 0x01 &&
+        data[2] == expectedChannel.load(std::memory_order_relaxed))
+        destination = PROGRAM_DUMP;
+    // DeviceInquiry response: 7E channel 06 02
+    else if (dataSize == DEVICE_ID_DATA_SIZE && data[0] == 0x7E && data[2] == 0x06 && data[3] == 0x02)
+        destination = DEVICE_ID;
+    else
+        return NOT_ROUTED;
+
+    auto& queue = queues[destination];
+    const auto scope = queue.fifo.write(1);
+    if (scope.blockSize1 + scope.blockSize2 == 0) {
+        nbOfDroppedMessages.fetch_add(1, std::memory_order_relaxed);
+        return NOT_ROUTED;
+    }
+
+    auto& slot = queue.slots[scope.blockSize1 > 0 ? scope.startIndex1 : scope.startIndex2];
+    memcpy(slot.data, data, static_cast<size_t>(dataSize));
+    slot.size = dataSize;
+    return destination;
+}
+
+bool MidiInputDemux::pop(Route route, MidiMessage& message) {
+    auto& queue = queues[route];
+    const auto scope = queue.fifo.read(1);
+    if (scope.blockSize1 + scope.blockSize2 == 0)
+        return false;
+
+    const auto& slot = queue.slots[scope.blockSize1 > 0 ? scope.startIndex1 : scope.startIndex2];
+    message = MidiMessage::createSysExMessage(slot.data, slot.size);
+    return true;
+}
+
+void MidiInputDemux::discard(Route route) {
+    auto& queue = queues[route];
+    queue.fifo.read(queue.fifo.getNumReady());
+}
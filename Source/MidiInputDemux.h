@@ -0,0 +1,64 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#pragma once
+
+#include <atomic>
+#include <juce_audio_basics/juce_audio_basics.h>
+
+using namespace juce;
+
+// Sorts the incoming MIDI traffic on the MIDI thread without allocating. Anything that isn't SysEx (notes, clock, active sensing...)
+// is dropped after a single byte check, and the SysEx answers we wait for are copied into preallocated slots, with one small queue
+// for each kind of answer. The queues are read by the thread waiting for the synth, which is the only place a MidiMessage is built.
+class MidiInputDemux {
+  public:
+    enum Route { PROGRAM_DUMP, DEVICE_ID, NB_OF_ROUTES, NOT_ROUTED = NB_OF_ROUTES };
+
+    // Called from the MIDI thread. Returns the queue the message went to, or NOT_ROUTED if it was dropped.
+    Route route(const MidiMessage& message);
+
+    // Program dumps from other channels are dropped, they can't be the answer to our requests
+    void setChannel(int channel) { expectedChannel.store(channel, std::memory_order_relaxed); }
+
+    // Called from the thread waiting for an answer. Only one thread may read the queues at a time.
+    bool pop(Route route, MidiMessage& message);
+    void discard(Route route);
+    // Messages we were waiting for but couldn't queue because their queue was full
+    int getNbOfDroppedMessages() const { return nbOfDroppedMessages.load(std::memory_order_relaxed); }
+
+  private:
+    static constexpr int PROG_DATA_SIZE = 210 - 2;
+    static constexpr int DEVICE_ID_DATA_SIZE = 15 - 2;
+    // The SysEx data of a program dump is the largest message we wait for
+    static const int SLOT_SIZE = PROG_DATA_SIZE;
+    // An AbstractFifo holds one less item than its size. More than one device may answer a DeviceInquiry.
+    static const int QUEUE_SIZE = 8;
+
+    struct Slot {
+        uint8_t data[SLOT_SIZE];
+        int size = 0;
+    };
+
+    struct Queue {
+        AbstractFifo fifo{QUEUE_SIZE};
+        Slot slots[QUEUE_SIZE];
+    };
+
+    Queue queues[NB_OF_ROUTES];
+    std::atomic<int> expectedChannel{0};
+    std::atomic<int> nbOfDroppedMessages{0};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiInputDemux)
+};
@@ -14,50 +14,88 @@
 
 #include "MidiSysexProcessor.h"
 #include "DeviceResponse.h"
-#include "MainComponent.h"
 #include "ProgramParser.h"
 
 using namespace juce;
 
-void MidiSysexProcessor::processIncomingMidiData(MidiInput* source, const MidiMessage& message) {
-    if (message.isSysEx())
-        // Add the received SysEx message to be processed
-        receivedSysExMessages.add(message);
+void MidiSysexProcessor::processIncomingMidiData(const MidiMessage& message) {
+    trafficRecorder.record(MidiTrafficRecorder::INCOMING, message);
+
+    // A program selected on the synth, or a dump it sends, replaces the program in its edit buffer
+    if (message.isProgramChange())
+        invalidateCachedProgram();
+
+    const auto route = inputDemux.route(message);
+    if (route == MidiInputDemux::PROGRAM_DUMP) {
+        invalidateCachedProgram();
+        programReceived.signal();
+    } else if (route == MidiInputDemux::DEVICE_ID)
+        deviceIdReceived.signal();
 }
 
-String MidiSysexProcessor::getChannel() { return String(requestPgmDumpMsg[CHANNEL_IDX] + 1); }
+String MidiSysexProcessor::getChannel() const { return String(requestPgmDumpMsg[CHANNEL_IDX] + 1); }
 
 void MidiSysexProcessor::setChannel(int channel) {
     intButtonMsg[CHANNEL_IDX] = static_cast<unsigned char>(channel);
     requestPgmDumpMsg[CHANNEL_IDX] = static_cast<unsigned char>(channel);
     sb5Msg[CHANNEL_IDX] = static_cast<unsigned char>(channel);
+    inputDemux.setChannel(channel);
+}
+
+void MidiSysexProcessor::sendMessage(const MidiMessage& message) {
+    trafficRecorder.record(MidiTrafficRecorder::OUTGOING, message);
+
+    sendToTransport(message);
+}
+
+void MidiSysexProcessor::setReplayTransport(MidiTransport* replay) {
+    const ScopedLock sl(transportLock);
+    replayTransport = replay;
+}
+
+bool MidiSysexProcessor::isReplaying() const {
+    const ScopedLock sl(transportLock);
+    return replayTransport != nullptr;
+}
+
+bool MidiSysexProcessor::isTransportOpen() const {
+    const ScopedLock sl(transportLock);
+    return replayTransport != nullptr || transport.isOpen();
+}
+
+void MidiSysexProcessor::sendToTransport(const MidiMessage& message) {
+    // Under the lock, so a replay can't be deleted while it's given a message
+    const ScopedLock sl(transportLock);
+    if (replayTransport != nullptr)
+        replayTransport->send(message);
+    else
+        transport.send(message);
 }
 
 DeviceResponse MidiSysexProcessor::requestDeviceInquiry() {
-    if (selectedMidiOut != nullptr) {
-        selectedMidiOut->sendMessageNow(MidiMessage::createSysExMessage(REQUEST_ID_MSG, sizeof(REQUEST_ID_MSG)));
+    if (isTransportOpen()) {
+        const ScopedLock sl(synthRequestLock);
+        inputDemux.discard(MidiInputDemux::DEVICE_ID);
+        sendMessage(MidiMessage::createSysExMessage(REQUEST_ID_MSG, sizeof(REQUEST_ID_MSG)));
         Thread::sleep(SYSEX_DELAY);
 
         // There may be more than one device that responds to the DeviceInquiry request, since it's part of the MIDI standard.
         // We need to get all the responses and check if any of them are from an SQ-80/ESQ-1 family of synths.
-        Array<MidiMessage> deviceIdMessages = receivedSysExMessages;
-        receivedSysExMessages.clear();
-
         Array<MidiMessage> sqEsqMessages;
-
-        for (auto deviceIdMessage : deviceIdMessages) {
-            if (deviceIdMessage.getSysExDataSize() == DEVICE_ID_SIZE) {
-                const uint8_t* deviceIdData = deviceIdMessage.getSysExData();
-                if (deviceIdData[FAMILY_IDX] == SQ_ESQ_FAMILY_ID) {
-                    setChannel(deviceIdData[RESPONSE_CHANNEL_IDX]);
-
-                    // If we find an ESQ-1, we don't need to check for others because the ESQ-1 has the most hidden waves.
-                    // This check will find ESQ-1s with OS version 3.00 and above.
-                    if (deviceIdData[MODEL_IDX] == ESQ1_ID)
-                        return getConnectionStatus(deviceIdMessage);
-                    else if (deviceIdData[MODEL_IDX] == ESQM_ID || deviceIdData[MODEL_IDX] == SQ80_ID)
-                        sqEsqMessages.add(deviceIdMessage);
-                }
+        MidiMessage deviceIdMessage;
+
+        while (inputDemux.pop(MidiInputDemux::DEVICE_ID, deviceIdMessage)) {
+            const uint8_t* deviceIdData = deviceIdMessage.getSysExData();
+            if (deviceIdData[FAMILY_IDX] == SQ_ESQ_FAMILY_ID) {
+                setChannel(deviceIdData[RESPONSE_CHANNEL_IDX]);
+
+                // If we find an ESQ-1, we don't need to check for others because the ESQ-1 has the most hidden waves.
+                // This check will find ESQ-1s with OS version 3.00 and above.
+                if (deviceIdData[MODEL_IDX] == ESQ1_ID) {
+                    inputDemux.discard(MidiInputDemux::DEVICE_ID);
+                    return getConnectionStatus(deviceIdMessage);
+                } else if (deviceIdData[MODEL_IDX] == ESQM_ID || deviceIdData[MODEL_IDX] == SQ80_ID)
+                    sqEsqMessages.add(deviceIdMessage);
             }
         }
         // This will pass an empty message if we don't find any SQ-80/ESQ-1 that responded to the DeviceInquiry request
@@ -65,32 +103,216 @@ DeviceResponse MidiSysexProcessor::requestDeviceInquiry() {
 
     } else
         // On launch, the program will try to connect to the synth automatically, so this displays the "refreshing" message
-        return DeviceResponse(STATUS_MESSAGES[REFRESHING], NO_PROG);
+        return DeviceResponse(REFRESHING, NO_PROG);
+}
+
+DeviceResponse MidiSysexProcessor::verifyKnownSynth(int channel, const MidiMessage& deviceIdMessage) {
+    if (!isTransportOpen())
+        return DeviceResponse(REFRESHING, NO_PROG);
+
+    // Another unit swapped onto these ports must not keep the cached model, the waves are numbered from the model's wave list.
+    // The ESQ-1s that don't answer the DeviceInquiry are cached without a device ID, any unit that answers is another one.
+    const auto deviceIdAnswer = requestSqEsqDeviceId(KNOWN_SYNTH_VERIFY_DELAY);
+    const bool knownSynthHasId = deviceIdMessage.getSysExDataSize() == DEVICE_ID_SIZE;
+    if (knownSynthHasId ? !isSameUnit(deviceIdAnswer, deviceIdMessage) : deviceIdAnswer.getSysExDataSize() == DEVICE_ID_SIZE)
+        return requestDeviceInquiry();
+
+    // The unit tells its channel, it may have been changed on its front panel since
+    setChannel(knownSynthHasId ? deviceIdAnswer.getSysExData()[RESPONSE_CHANNEL_IDX] : channel);
+    auto currentProg = requestProgramDump(KNOWN_SYNTH_VERIFY_DELAY);
+    if (currentProg.getSysExDataSize() == SQ_ESQ_PROG_SIZE)
+        return DeviceResponse(CONNECTED, knownSynthHasId ? deviceIdAnswer : deviceIdMessage, currentProg);
+
+    return requestDeviceInquiry();
+}
+
+MidiMessage MidiSysexProcessor::requestSqEsqDeviceId(int delay) {
+    const ScopedLock sl(synthRequestLock);
+    inputDemux.discard(MidiInputDemux::DEVICE_ID);
+    deviceIdReceived.reset();
+    sendMessage(MidiMessage::createSysExMessage(REQUEST_ID_MSG, sizeof(REQUEST_ID_MSG)));
+
+    // Other devices may answer first, the wait only ends early for one of ours
+    const auto deadline = Time::getMillisecondCounterHiRes() + delay;
+    MidiMessage answer;
+    for (;;) {
+        while (inputDemux.pop(MidiInputDemux::DEVICE_ID, answer))
+            if (answer.getSysExData()[FAMILY_IDX] == SQ_ESQ_FAMILY_ID)
+                return answer;
+
+        const auto remaining = deadline - Time::getMillisecondCounterHiRes();
+        if (remaining <= 0)
+            return {};
+        deviceIdReceived.wait(jmax(1, static_cast<int>(std::ceil(remaining))));
+    }
+}
+
+bool MidiSysexProcessor::isSameUnit(const MidiMessage& answer, const MidiMessage& knownDeviceId) {
+    if (answer.getSysExDataSize() != DEVICE_ID_SIZE || knownDeviceId.getSysExDataSize() != DEVICE_ID_SIZE)
+        return false;
+    const auto* answerData = answer.getSysExData();
+    const auto* knownData = knownDeviceId.getSysExData();
+    for (auto idx : {FAMILY_IDX, MODEL_IDX, OS_VERSION_IDX[MINOR], OS_VERSION_IDX[MAJOR]})
+        if (answerData[idx] != knownData[idx])
+            return false;
+    return true;
 }
 
 MidiMessage MidiSysexProcessor::requestProgramDump(int delay) {
+    const ScopedLock sl(synthRequestLock);
+    // A late answer to an earlier request must not be taken for this one
+    inputDemux.discard(MidiInputDemux::PROGRAM_DUMP);
+    programReceived.reset();
+
     // Send the program dump request
-    if (selectedMidiOut != nullptr) {
-        selectedMidiOut->sendMessageNow(MidiMessage::createSysExMessage(requestPgmDumpMsg, sizeof(requestPgmDumpMsg)));
+    if (isTransportOpen()) {
+        sendMessage(MidiMessage::createSysExMessage(requestPgmDumpMsg, sizeof(requestPgmDumpMsg)));
     }
 
-    Thread::sleep(delay);
+    // The delay is only a timeout, we stop waiting as soon as the program arrives
+    programReceived.wait(delay);
 
-    // Read the incoming SysEx message
-    auto program = receivedSysExMessages.getFirst();
+    // Read the incoming program, an empty message means the synth didn't answer
+    MidiMessage program;
+    inputDemux.pop(MidiInputDemux::PROGRAM_DUMP, program);
 
-    // Clear the array of received messages
-    receivedSysExMessages.clear();
+    if (program.getSysExDataSize() == SQ_ESQ_PROG_SIZE)
+        updateCachedProgram(program);
 
     return program;
 }
 
+MidiMessage MidiSysexProcessor::getProgramToEdit(ProgramSource source) {
+    // After a while without any edit, the program may have been changed on the synth without it telling us
+    if (source == FROM_CACHE && Time::getMillisecondCounterHiRes() - cachedProgramTime.load() < CACHE_IDLE_TIMEOUT) {
+        const ScopedLock sl(cachedProgramLock);
+        if (cachedProgram.getSysExDataSize() == SQ_ESQ_PROG_SIZE)
+            return cachedProgram;
+    }
+    return requestProgramDump(SYSEX_DELAY);
+}
+
+void MidiSysexProcessor::updateCachedProgram(const MidiMessage& program) {
+    const ScopedLock sl(cachedProgramLock);
+    cachedProgram = program;
+    cachedProgramTime.store(Time::getMillisecondCounterHiRes());
+}
+
 void MidiSysexProcessor::sendProgramDump(HeapBlock<uint8_t>& progData) {
     // Create a new SysEx message with the modified data
-    MidiMessage modifiedProgram = MidiMessage::createSysExMessage(progData, SQ_ESQ_PROG_SIZE);
-    selectedMidiOut->sendMessageNow(MidiMessage::createSysExMessage(intButtonMsg, sizeof(intButtonMsg)));
-    selectedMidiOut->sendMessageNow(modifiedProgram);
-    selectedMidiOut->sendMessageNow(MidiMessage::createSysExMessage(sb5Msg, sizeof(sb5Msg)));
+    auto program = MidiMessage::createSysExMessage(progData, SQ_ESQ_PROG_SIZE);
+    const ScopedLock sl(sendLock);
+    const auto generation = ++sendGeneration;
+    transmitProgram(program);
+
+    if (verifyEnabled.load() && !isReplaying())
+        scheduleVerify(program, generation);
+}
+
+void MidiSysexProcessor::sendProgramMessage(const MidiMessage& program) {
+    const ScopedLock sl(sendLock);
+    ++sendGeneration;
+    transmitProgram(program);
+}
+
+MidiSysexProcessor::BankUploadResult MidiSysexProcessor::uploadBank(const uint8_t* bankData, const std::function<void(double progress)>& onProgress) {
+    // Dump requests wait for the upload, and the programs sent meanwhile wait for bankUploadEndMs
+    const ScopedLock sl(synthRequestLock);
+    BankUploadResult result;
+
+    const auto bankMessage = MidiMessage::createSysExMessage(bankData, ProgramParser::BANK_DATA_SIZE);
+    const auto rawSize = bankMessage.getRawDataSize();
+    const auto startTime = Time::getMillisecondCounterHiRes();
+    bankUploadEndMs.store(startTime + getWireTimeMs(rawSize) + BANK_STORE_TIMEOUT);
+    // The synth loads a program of the new bank, the first answer below replaces the cached one
+    invalidateCachedProgram();
+    trafficRecorder.record(MidiTrafficRecorder::OUTGOING, bankMessage);
+
+    // The drivers only take whole SysEx messages, so the dump goes out in one piece. The progress follows the time it takes on the wire.
+    sendToTransport(bankMessage);
+    const auto handOffEnd = startTime + getWireTimeMs(rawSize);
+    for (auto now = Time::getMillisecondCounterHiRes(); now < handOffEnd; now = Time::getMillisecondCounterHiRes()) {
+        if (onProgress)
+            onProgress((now - startTime) / (handOffEnd - startTime));
+        Thread::sleep(jmin(BANK_PROGRESS_INTERVAL, static_cast<int>(std::ceil(handOffEnd - now))));
+    }
+    if (onProgress)
+        onProgress(1.0);
+
+    // The synth ignores the requests while it stores the bank, and answers the first one it gets once it's done. They are sent
+    // more often than an answer takes on the wire, so the answers are only cleared once, before the first request.
+    inputDemux.discard(MidiInputDemux::PROGRAM_DUMP);
+    const auto requestMessage = MidiMessage::createSysExMessage(requestPgmDumpMsg, sizeof(requestPgmDumpMsg));
+    while (Time::getMillisecondCounterHiRes() < handOffEnd + BANK_STORE_TIMEOUT) {
+        programReceived.reset();
+        sendMessage(requestMessage);
+        programReceived.wait(BANK_POLL_INTERVAL);
+
+        MidiMessage program;
+        if (inputDemux.pop(MidiInputDemux::PROGRAM_DUMP, program) && program.getSysExDataSize() == SQ_ESQ_PROG_SIZE) {
+            // The synth was ready when it started answering, the time the answer took on the wire isn't part of the upload
+            const auto readyTime = Time::getMillisecondCounterHiRes() - getWireTimeMs(program.getRawDataSize());
+            result.confirmed = true;
+            result.durationMs = jmax(getWireTimeMs(rawSize), readyTime - startTime);
+            result.bytesPerSecond = rawSize * 1000.0 / result.durationMs;
+            updateCachedProgram(program);
+            break;
+        }
+    }
+
+    bankUploadEndMs.store(0.0);
+    return result;
+}
+
+void MidiSysexProcessor::waitForBankUpload() const {
+    // The end is only a deadline, it's cleared as soon as the synth has taken the bank
+    while (Time::getMillisecondCounterHiRes() < bankUploadEndMs.load())
+        Thread::sleep(10);
+}
+
+void MidiSysexProcessor::transmitProgram(const MidiMessage& program) {
+    waitForBankUpload();
+    updateCachedProgram(program);
+    sendMessage(MidiMessage::createSysExMessage(intButtonMsg, sizeof(intButtonMsg)));
+    sendMessage(program);
+    sendMessage(MidiMessage::createSysExMessage(sb5Msg, sizeof(sb5Msg)));
+}
+
+void MidiSysexProcessor::scheduleVerify(const MidiMessage& program, uint32_t generation) {
+    verifyQueue.addJob([this, program, generation, sendTime = Time::getMillisecondCounterHiRes()]() mutable {
+        for (int retry = 0;; retry++) {
+            // A newer program replaces this one, there is nothing left to check
+            if (sendGeneration.load() != generation)
+                return;
+
+            // The synth can only answer once the program is through the wire and loaded
+            const auto remaining = sendTime + getProgramSendTimeMs() - Time::getMillisecondCounterHiRes();
+            if (remaining > 0)
+                Thread::sleep(static_cast<int>(std::ceil(remaining)));
+
+            if (sendGeneration.load() != generation)
+                return;
+            auto synthProgram = requestProgramDump(SYSEX_DELAY);
+            if (sendGeneration.load() != generation)
+                return;
+
+            if (synthProgram.getSysExDataSize() == SQ_ESQ_PROG_SIZE && memcmp(synthProgram.getSysExData(), program.getSysExData(), SQ_ESQ_PROG_SIZE) == 0)
+                return;
+
+            if (retry == MAX_VERIFY_RETRIES) {
+                if (onVerifyFailed)
+                    onVerifyFailed(synthProgram);
+                return;
+            }
+
+            // A newer program may have been sent since the read-back, and it must never be replaced by this one
+            const ScopedLock sl(sendLock);
+            if (sendGeneration.load() != generation)
+                return;
+            transmitProgram(program);
+            sendTime = Time::getMillisecondCounterHiRes();
+        }
+    });
 }
 
 DeviceResponse MidiSysexProcessor::getConnectionStatus(MidiMessage deviceIdMessage) {
@@ -109,18 +331,20 @@ DeviceResponse MidiSysexProcessor::getConnectionStatus(MidiMessage deviceIdMessa
     }
 
     if (receivedValidProgram)
-        return DeviceResponse(STATUS_MESSAGES[CONNECTED], deviceIdMessage, currentProg);
+        return DeviceResponse(CONNECTED, deviceIdMessage, currentProg);
     else {
         if (deviceIdMessage.getSysExDataSize() == DEVICE_ID_SIZE)
-            return DeviceResponse(STATUS_MESSAGES[SYSEX_DISABLED], deviceIdMessage, currentProg);
+            return DeviceResponse(SYSEX_DISABLED, deviceIdMessage, currentProg);
         else
             // This will be the response for ESQ-1s with OS < 3.00 which are connected correctly but with SysEx disabled
-            return DeviceResponse(STATUS_MESSAGES[DISCONNECTED], NO_PROG);
+            return DeviceResponse(DISCONNECTED, NO_PROG);
     }
 }
 
-DeviceResponse MidiSysexProcessor::changeOscWaveform(int oscNumber, int waveformIndex) {
-    auto currentProg = requestProgramDump(SYSEX_DELAY);
+DeviceResponse MidiSysexProcessor::changeOscWaveform(int oscNumber, int waveformIndex, ProgramSource source) {
+    // The program read and the one sent with the edit must be the same, no other edit can go in between
+    const ScopedLock sl(sendLock);
+    auto currentProg = getProgramToEdit(source);
     const uint8_t* progData = currentProg.getSysExData();
 
     // Check if we received a valid program dump from the synth
@@ -138,14 +362,15 @@ DeviceResponse MidiSysexProcessor::changeOscWaveform(int oscNumber, int waveform
 
         // Update the program that will be sent back to the updateStatus method
         MidiMessage modifiedProg = MidiMessage::createSysExMessage(modifiedProgData, SQ_ESQ_PROG_SIZE);
-        return DeviceResponse(STATUS_MESSAGES[CONNECTED], modifiedProg);
+        return DeviceResponse(CONNECTED, modifiedProg);
     } else
-        return DeviceResponse(STATUS_MESSAGES[DISCONNECTED], NO_PROG);
+        return DeviceResponse(DISCONNECTED, NO_PROG);
 }
 
-DeviceResponse MidiSysexProcessor::changeOscPitch(int oscNumber, int octave, int semitone, bool inLowFreqRange) {
+DeviceResponse MidiSysexProcessor::changeOscPitch(int oscNumber, int octave, int semitone, bool inLowFreqRange, ProgramSource source) {
+    const ScopedLock sl(sendLock);
 
-    auto currentProg = requestProgramDump(SYSEX_DELAY);
+    auto currentProg = getProgramToEdit(source);
     const uint8_t* progData = currentProg.getSysExData();
 
     // Check if we received a valid program dump from the synth
@@ -193,17 +418,18 @@ DeviceResponse MidiSysexProcessor::changeOscPitch(int oscNumber, int octave, int
 
         // Update the program that will be sent back to the updateStatus method
         MidiMessage modifiedProg = MidiMessage::createSysExMessage(modifiedProgData, SQ_ESQ_PROG_SIZE);
-        return DeviceResponse(STATUS_MESSAGES[CONNECTED], modifiedProg);
+        return DeviceResponse(CONNECTED, modifiedProg);
     } else
-        return DeviceResponse(STATUS_MESSAGES[DISCONNECTED], NO_PROG);
+        return DeviceResponse(DISCONNECTED, NO_PROG);
 }
 
-DeviceResponse MidiSysexProcessor::toggleLowFrequencyMode(int oscNumber, bool lowFreqEnabled) {
+DeviceResponse MidiSysexProcessor::toggleLowFrequencyMode(int oscNumber, bool lowFreqEnabled, ProgramSource source) {
+    const ScopedLock sl(sendLock);
     // OCT+7 SEMI+8 is when the DOC wraps around and generates very low frequencies. It will show on the unit as OCT-3.
     // It sets the oscillator in a different frequency range, a bit like what toggleSelfOscillation() does for resonance.
     // Here we set it to OCT-2 by default because OCT-3 is still a very high frequency but from a different waveform, because... reasons.
 
-    auto currentProg = requestProgramDump(SYSEX_DELAY);
+    auto currentProg = getProgramToEdit(source);
     const uint8_t* progData = currentProg.getSysExData();
 
     // Check if we received a valid program dump from the synth
@@ -237,13 +463,14 @@ DeviceResponse MidiSysexProcessor::toggleLowFrequencyMode(int oscNumber, bool lo
 
         // Update the program that will be sent back to the updateStatus method
         MidiMessage modifiedProgram = MidiMessage::createSysExMessage(modifiedprogData, SQ_ESQ_PROG_SIZE);
-        return DeviceResponse(STATUS_MESSAGES[CONNECTED], modifiedProgram);
+        return DeviceResponse(CONNECTED, modifiedProgram);
     } else
-        return DeviceResponse(STATUS_MESSAGES[DISCONNECTED], NO_PROG);
+        return DeviceResponse(DISCONNECTED, NO_PROG);
 }
 
-DeviceResponse MidiSysexProcessor::toggleSelfOscillation(ToggleButton& selfOscButton) {
-    auto currentProg = requestProgramDump(SYSEX_DELAY);
+DeviceResponse MidiSysexProcessor::toggleSelfOscillation(bool selfOscEnabled, ProgramSource source) {
+    const ScopedLock sl(sendLock);
+    auto currentProg = getProgramToEdit(source);
     const uint8_t* progData = currentProg.getSysExData();
 
     // Check if we received a valid program dump from the synth
@@ -252,7 +479,7 @@ DeviceResponse MidiSysexProcessor::toggleSelfOscillation(ToggleButton& selfOscBu
         HeapBlock<uint8_t> modProgData(SQ_ESQ_PROG_SIZE);
         memcpy(modProgData.getData(), progData, SQ_ESQ_PROG_SIZE);
 
-        if (selfOscButton.getToggleState()) {
+        if (selfOscEnabled) {
             // Save the resonance value for the normal state
             resValuesNormal[0] = progData[ProgramParser::RES[0]];
             resValuesNormal[1] = progData[ProgramParser::RES[1]];
@@ -275,8 +502,26 @@ DeviceResponse MidiSysexProcessor::toggleSelfOscillation(ToggleButton& selfOscBu
 
         // Update the program that will be sent back to the updateStatus method
         MidiMessage modifiedProgram = MidiMessage::createSysExMessage(modProgData, SQ_ESQ_PROG_SIZE);
-        return DeviceResponse(STATUS_MESSAGES[CONNECTED], modifiedProgram);
+        return DeviceResponse(CONNECTED, modifiedProgram);
     } else {
-        return DeviceResponse(STATUS_MESSAGES[DISCONNECTED], NO_PROG);
+        return DeviceResponse(DISCONNECTED, NO_PROG);
     }
-}
\ No newline at end of file
+}
+
+DeviceResponse MidiSysexProcessor::editProgram(const std::function<void(uint8_t* progData)>& edit, ProgramSource source) {
+    const ScopedLock sl(sendLock);
+    auto currentProg = getProgramToEdit(source);
+
+    // Check if we received a valid program dump from the synth
+    if (currentProg.getSysExDataSize() == SQ_ESQ_PROG_SIZE) {
+        HeapBlock<uint8_t> modProgData(SQ_ESQ_PROG_SIZE);
+        memcpy(modProgData.getData(), currentProg.getSysExData(), SQ_ESQ_PROG_SIZE);
+
+        edit(modProgData.getData());
+        sendProgramDump(modProgData);
+
+        MidiMessage modifiedProgram = MidiMessage::createSysExMessage(modProgData, SQ_ESQ_PROG_SIZE);
+        return DeviceResponse(CONNECTED, modifiedProgram);
+    } else
+        return DeviceResponse(DISCONNECTED, NO_PROG);
+}
@@ -15,7 +15,13 @@
 #pragma once
 
 #include "DeviceResponse.h"
-#include <JuceHeader.h>
+#include "MidiInputDemux.h"
+#include "MidiTrafficRecorder.h"
+#include "MidiTransport.h"
+#include "SynthState.h"
+#include "SysexMessages.h"
+#include <atomic>
+#include <juce_audio_basics/juce_audio_basics.h>
 
 using namespace juce;
 
@@ -23,38 +29,107 @@ static const MidiMessage NO_PROG = MidiMessage();
 
 class MidiSysexProcessor {
   public:
-    const int CHANNEL_IDX = 3;
+    static constexpr int CHANNEL_IDX = SysexMessages::CHANNEL_IDX;
+    static constexpr int SQ_ESQ_PROG_SIZE = SysexMessages::PROG_SIZE;
 
-    std::unique_ptr<MidiInput> selectedMidiIn;
-    std::unique_ptr<MidiOutput> selectedMidiOut;
+    MidiTrafficRecorder trafficRecorder;
+    // Published by the UI when the connection status or model changes, readable from any thread
+    SynthState synthState;
 
-    void processIncomingMidiData(MidiInput* source, const MidiMessage& message);
+    // Where the edit methods take the program to modify from. FROM_CACHE uses the last program received from or sent to
+    // the synth, saving the dump request round-trip, and falls back to FROM_SYNTH if that program may no longer be current.
+    enum ProgramSource { FROM_SYNTH, FROM_CACHE };
+
+    MidiSysexProcessor(MidiTransport& transport) : transport(transport) {
+        memcpy(intButtonMsg, SysexMessages::INT_BUTTON, sizeof(intButtonMsg));
+        memcpy(requestPgmDumpMsg, SysexMessages::REQUEST_PGM_DUMP, sizeof(requestPgmDumpMsg));
+        memcpy(sb5Msg, SysexMessages::SB5, sizeof(sb5Msg));
+    }
+
+    void processIncomingMidiData(const MidiMessage& message);
 
     DeviceResponse requestDeviceInquiry();
+    // Fast path for a synth already found on these ports: its DeviceInquiry answer confirms it's the same unit, and a single
+    // program dump gets its program. Falls back to the full DeviceInquiry if another unit answers or if it doesn't answer.
+    DeviceResponse verifyKnownSynth(int channel, const MidiMessage& deviceIdMessage);
     MidiMessage requestProgramDump(int delay);
     void sendProgramDump(HeapBlock<uint8_t>& progData);
-    DeviceResponse toggleSelfOscillation(ToggleButton& selfOscButton);
-    DeviceResponse changeOscWaveform(int oscNumber, int waveformIndex);
-    DeviceResponse changeOscPitch(int oscNumber, int octave, int semitone, bool inLowFreqRange);
-    DeviceResponse toggleLowFrequencyMode(int oscNumber, bool lowFreqEnabled);
-    String getChannel();
+    // Sends an already built program dump message, for callers that prepare their programs ahead of time
+    void sendProgramMessage(const MidiMessage& program);
+
+    struct BankUploadResult {
+        // The synth answered a dump request once it had taken the bank
+        bool confirmed = false;
+        // From the start of the upload until the synth started answering again, within BANK_POLL_INTERVAL
+        double durationMs = 0.0;
+        double bytesPerSecond = 0.0;
+    };
+    // Writes an all-programs dump into the synth's memory, the SysEx data without its header and footer. This blocks until the
+    // synth has taken the bank, and nothing else is sent to it in the meantime. The progress goes from 0 to 1 with the time the
+    // bank takes on the wire, and is called from the calling thread.
+    BankUploadResult uploadBank(const uint8_t* bankData, const std::function<void(double progress)>& onProgress = nullptr);
+    MidiMessage getProgramToEdit(ProgramSource source);
+    DeviceResponse toggleSelfOscillation(bool selfOscEnabled, ProgramSource source = FROM_SYNTH);
+    DeviceResponse changeOscWaveform(int oscNumber, int waveformIndex, ProgramSource source = FROM_SYNTH);
+    DeviceResponse changeOscPitch(int oscNumber, int octave, int semitone, bool inLowFreqRange, ProgramSource source = FROM_SYNTH);
+    DeviceResponse toggleLowFrequencyMode(int oscNumber, bool lowFreqEnabled, ProgramSource source = FROM_SYNTH);
+    // Applies any modification to the program nibbles and sends the result
+    DeviceResponse editProgram(const std::function<void(uint8_t* progData)>& edit, ProgramSource source = FROM_SYNTH);
+
+    static constexpr double getWireTimeMs(int nbOfBytes) { return SysexMessages::getWireTimeMs(nbOfBytes); }
+    double getProgramSendTimeMs() const { return SysexMessages::getProgramSendTimeMs(); }
+    String getChannel() const;
     void setChannel(int channel);
+    // While set, the messages go to the replay instead of the synth, which answers them from a recorded session.
+    // Set it back to nullptr before deleting the replay.
+    void setReplayTransport(MidiTransport* replay);
+    bool isReplaying() const;
+
+    // When enabled, every edit is read back from the synth in the background once it's through the wire, and sent again if the
+    // synth has something else. Sending another program cancels the check of the previous one, so the next edit never waits for it.
+    void setVerifyEnabled(bool shouldVerify) { verifyEnabled.store(shouldVerify); }
+    bool isVerifyEnabled() const { return verifyEnabled.load(); }
+    // Called from the verify thread when the synth still has another program after all the retries
+    std::function<void(const MidiMessage& synthProgram)> onVerifyFailed;
 
   private:
-    // Channel 1 by default
-    unsigned char intButtonMsg[7] = {0xF0, 0x0F, 0x02, 0x00, 0x0E, 0x26, 0xF7};
-    unsigned char requestPgmDumpMsg[6] = {0xF0, 0x0F, 0x02, 0x00, 0x09, 0xF7};
-    unsigned char sb5Msg[8] = {0xF0, 0x0F, 0x02, 0x00, 0x0E, 0x2F, 0x62, 0xF7};
-
-    Array<MidiMessage> receivedSysExMessages;
+    MidiTransport& transport;
+
+    // Copies of the SysexMessages templates with the current channel, channel 1 by default
+    unsigned char intButtonMsg[sizeof(SysexMessages::INT_BUTTON)];
+    unsigned char requestPgmDumpMsg[sizeof(SysexMessages::REQUEST_PGM_DUMP)];
+    unsigned char sb5Msg[sizeof(SysexMessages::SB5)];
+
+    // The answers from the synth, sorted on the MIDI thread without allocating
+    MidiInputDemux inputDemux;
+    // Signaled when a program dump arrives, so the dump requests don't have to wait for their whole delay
+    WaitableEvent programReceived;
+    WaitableEvent deviceIdReceived;
+
+    // Last program received from or sent to the synth, and when. It's only used for CACHE_IDLE_TIMEOUT after that, and
+    // invalidated as soon as the synth selects or sends another program. Invalidating only resets the time, so it can be
+    // done on the MIDI thread.
+    MidiMessage cachedProgram;
+    CriticalSection cachedProgramLock;
+    std::atomic<double> cachedProgramTime{0.0};
+    static constexpr double CACHE_IDLE_TIMEOUT = 1500.0;
+    MidiTransport* replayTransport = nullptr;
+    mutable CriticalSection transportLock;
 
     const int SYSEX_DELAY = 700;
+    // A known synth answers a dump request in about 100 ms, this leaves some margin for slow MIDI interfaces
+    const int KNOWN_SYNTH_VERIFY_DELAY = 250;
+    // The synth ignores what it receives while it stores a bank. It's polled with short dump requests after the wire time
+    // to know when it's done, until this timeout.
+    static constexpr double BANK_STORE_TIMEOUT = 2000.0;
+    const int BANK_POLL_INTERVAL = 20;
+    // How often the progress is reported while the bank is on the wire
+    const int BANK_PROGRESS_INTERVAL = 50;
+    // Until then, the programs sent wait for a bank upload to be through
+    std::atomic<double> bankUploadEndMs{0.0};
 
     enum VersionNumber { MINOR, MAJOR };
 
-    // We subtract 2 to exclude the SysEx header and footer
-    const int SQ_ESQ_PROG_SIZE = 210 - 2;
-
     const unsigned char REQUEST_ID_MSG[6] = {0xF0, 0x7E, 0x7F, 0x06, 0x01, 0xF7};
 
     // If we have toggleable ranges, this is to remember the values for each state. The ones here are the default values
@@ -69,5 +144,33 @@ class MidiSysexProcessor {
     uint8_t pitchToggleNormal[3][2] = {{0x4, 0x2}, {0x4, 0x2}, {0x4, 0x2}};
     uint8_t pitchToggleLowFreq[3][2] = {{0xC, 0x8}, {0xC, 0x8}, {0xC, 0x8}};
 
+    // Serialises the requests that wait for an answer from the synth, so a verify can't take the answer to an edit's dump request
+    CriticalSection synthRequestLock;
+
+    // Held while a program is sent, and by the edits from the moment they read the program until they send it, whichever
+    // thread they come from: the UI, the CC mapper, the control server or the scripts. A verify holds it to check that no
+    // newer program went out and resend its own as one step.
+    CriticalSection sendLock;
+
+    std::atomic<bool> verifyEnabled{false};
+    // Incremented on every program sent, a verify is dropped as soon as it no longer matches
+    std::atomic<uint32_t> sendGeneration{0};
+    static const int MAX_VERIFY_RETRIES = 2;
+
     DeviceResponse getConnectionStatus(MidiMessage deviceIdMessage);
+    // The first answer to a DeviceInquiry from an SQ-80/ESQ-1 family unit, or an empty message after the delay
+    MidiMessage requestSqEsqDeviceId(int delay);
+    // Same family, model and OS version
+    static bool isSameUnit(const MidiMessage& answer, const MidiMessage& knownDeviceId);
+    void sendMessage(const MidiMessage& message);
+    void sendToTransport(const MidiMessage& message);
+    bool isTransportOpen() const;
+    void transmitProgram(const MidiMessage& program);
+    void waitForBankUpload() const;
+    void scheduleVerify(const MidiMessage& program, uint32_t generation);
+    void updateCachedProgram(const MidiMessage& program);
+    void invalidateCachedProgram() { cachedProgramTime.store(0.0); }
+
+    // Declared last so it's deleted first, while the rest of the processor is still there for a running verify
+    ThreadPool verifyQueue{1};
 };
\ No newline at end of file
@@ -0,0 +1,220 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#include "MidiTrafficRecorder.h"
+#include "MidiSysexProcessor.h"
+
+using namespace juce;
+
+MidiTrafficRecorder::MidiTrafficRecorder(size_t capacity) : ring(capacity), capacity(capacity) {}
+
+void MidiTrafficRecorder::start() {
+    const SpinLock::ScopedLockType sl(lock);
+    readPos = 0;
+    usedBytes = 0;
+    startTime = Time::getMillisecondCounterHiRes();
+    recording.store(true);
+}
+
+void MidiTrafficRecorder::stop() { recording.store(false); }
+
+void MidiTrafficRecorder::record(Direction direction, const MidiMessage& message) {
+    if (!isRecording())
+        return;
+
+    const auto messageSize = static_cast<size_t>(message.getRawDataSize());
+    const auto entrySize = ENTRY_HEADER_SIZE + messageSize;
+    // Messages that don't fit in the size field or in the ring itself are not recorded
+    if (messageSize > 0xFFFF || entrySize > capacity)
+        return;
+
+    const auto timestamp = static_cast<int64>((Time::getMillisecondCounterHiRes() - startTime) * 1000.0);
+
+    // The header is always written in little-endian so recordings can be replayed on any platform
+    uint8_t header[ENTRY_HEADER_SIZE];
+    header[0] = direction;
+    for (int i = 0; i < 8; i++)
+        header[1 + i] = static_cast<uint8_t>(timestamp >> (8 * i));
+    header[9] = static_cast<uint8_t>(messageSize & 0xFF);
+    header[10] = static_cast<uint8_t>(messageSize >> 8);
+
+    const SpinLock::ScopedLockType sl(lock);
+
+    // Make room for the new entry by dropping the oldest ones
+    while (capacity - usedBytes < entrySize)
+        dropOldestEntry();
+
+    const auto writePos = (readPos + usedBytes) % capacity;
+    writeBytes(writePos, header, ENTRY_HEADER_SIZE);
+    writeBytes((writePos + ENTRY_HEADER_SIZE) % capacity, message.getRawData(), messageSize);
+    usedBytes += entrySize;
+}
+
+void MidiTrafficRecorder::writeBytes(size_t pos, const void* data, size_t size) {
+    auto source = static_cast<const uint8_t*>(data);
+    const auto firstPart = jmin(size, capacity - pos);
+    memcpy(ring.getData() + pos, source, firstPart);
+    memcpy(ring.getData(), source + firstPart, size - firstPart);
+}
+
+void MidiTrafficRecorder::readBytes(size_t pos, void* data, size_t size) const {
+    auto destination = static_cast<uint8_t*>(data);
+    const auto firstPart = jmin(size, capacity - pos);
+    memcpy(destination, ring.getData() + pos, firstPart);
+    memcpy(destination + firstPart, ring.getData(), size - firstPart);
+}
+
+void MidiTrafficRecorder::dropOldestEntry() {
+    uint8_t header[ENTRY_HEADER_SIZE];
+    readBytes(readPos, header, ENTRY_HEADER_SIZE);
+    const auto entrySize = ENTRY_HEADER_SIZE + (header[9] | (header[10] << 8));
+
+    readPos = (readPos + entrySize) % capacity;
+    usedBytes -= entrySize;
+}
+
+bool MidiTrafficRecorder::saveToFile(const File& file) {
+    // Copy the ring in chronological order so we don't hold the lock while writing to disk
+    MemoryBlock contents;
+    {
+        const SpinLock::ScopedLockType sl(lock);
+        contents.setSize(usedBytes);
+        readBytes(readPos, contents.getData(), usedBytes);
+    }
+
+    file.deleteFile();
+    FileOutputStream output(file);
+    if (!output.openedOk())
+        return false;
+
+    output.write(FILE_MAGIC, sizeof(FILE_MAGIC));
+    output.writeByte(static_cast<char>(FILE_VERSION));
+    output.write(contents.getData(), contents.getSize());
+    output.flush();
+
+    return output.getStatus().wasOk();
+}
+
+bool MidiTrafficRecorder::loadFromFile(const File& file, Array<Entry>& entries) {
+    FileInputStream input(file);
+    if (!input.openedOk())
+        return false;
+
+    char magic[sizeof(FILE_MAGIC)];
+    if (input.read(magic, sizeof(magic)) != sizeof(magic) || memcmp(magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 || input.readByte() != FILE_VERSION)
+        return false;
+
+    entries.clear();
+    HeapBlock<uint8_t> messageData(0xFFFF);
+
+    while (input.getNumBytesRemaining() >= static_cast<int64>(ENTRY_HEADER_SIZE)) {
+        auto direction = static_cast<Direction>(input.readByte());
+        auto timestamp = input.readInt64();
+        auto messageSize = static_cast<int>(static_cast<uint16>(input.readShort()));
+
+        if (input.read(messageData.getData(), messageSize) != messageSize)
+            return false;
+
+        entries.add({direction, timestamp, MidiMessage(messageData.getData(), messageSize, timestamp / 1000000.0)});
+    }
+    return true;
+}
+
+//==============================================================================
+MidiTrafficReplayer::MidiTrafficReplayer(MidiSysexProcessor& processor) : Thread("MIDI traffic replay"), processor(processor) {}
+
+MidiTrafficReplayer::~MidiTrafficReplayer() { stopReplay(); }
+
+bool MidiTrafficReplayer::load(const File& file) { return MidiTrafficRecorder::loadFromFile(file, entries); }
+
+void MidiTrafficReplayer::startReplay(double speed) {
+    stopReplay();
+    replaySpeed = jmax(speed, 0.01);
+
+    {
+        const ScopedLock sl(answersLock);
+        pendingAnswers.clearQuick();
+        nextEntryIdx = 0;
+        lastActivityTime = Time::getMillisecondCounterHiRes();
+        // What the synth sent on its own before the first recorded request, relative to the start of the recording
+        if (!entries.isEmpty())
+            scheduleAnswers(-1, lastActivityTime);
+    }
+    startThread(Priority::high);
+}
+
+void MidiTrafficReplayer::stopReplay() { stopThread(1000); }
+
+void MidiTrafficReplayer::scheduleAnswers(int requestIdx, double requestTime) {
+    const auto requestTimestamp = requestIdx < 0 ? entries.getFirst().timestamp : entries.getReference(requestIdx).timestamp;
+    int entryIdx = requestIdx + 1;
+    for (; entryIdx < entries.size() && entries.getReference(entryIdx).direction == MidiTrafficRecorder::INCOMING; entryIdx++)
+        pendingAnswers.add({entryIdx, requestTime + (entries.getReference(entryIdx).timestamp - requestTimestamp) / 1000.0 / replaySpeed});
+    nextEntryIdx = entryIdx;
+}
+
+void MidiTrafficReplayer::send(const MidiMessage& message) {
+    const auto sendTime = Time::getMillisecondCounterHiRes();
+    const ScopedLock sl(answersLock);
+
+    // The next time this message was sent in the recording. The ones the processor doesn't send this time are skipped, with their answers.
+    for (int entryIdx = nextEntryIdx; entryIdx < entries.size(); entryIdx++) {
+        const auto& entry = entries.getReference(entryIdx);
+        if (entry.direction == MidiTrafficRecorder::OUTGOING && entry.message.getRawDataSize() == message.getRawDataSize() &&
+            memcmp(entry.message.getRawData(), message.getRawData(), static_cast<size_t>(message.getRawDataSize())) == 0) {
+            scheduleAnswers(entryIdx, sendTime);
+            lastActivityTime = sendTime;
+            notify();
+            return;
+        }
+    }
+}
+
+void MidiTrafficReplayer::run() {
+    while (!threadShouldExit()) {
+        Answer answer{};
+        bool hasAnswer;
+        bool finished;
+        {
+            const ScopedLock sl(answersLock);
+            hasAnswer = !pendingAnswers.isEmpty();
+            if (hasAnswer)
+                answer = pendingAnswers.getFirst();
+            finished = !hasAnswer && (nextEntryIdx >= entries.size() || Time::getMillisecondCounterHiRes() - lastActivityTime > IDLE_TIMEOUT);
+        }
+
+        if (finished)
+            break;
+        if (!hasAnswer) {
+            wait(100);
+            continue;
+        }
+
+        const auto remaining = answer.dueTime - Time::getMillisecondCounterHiRes();
+        if (remaining > 0) {
+            wait(jmax(1, static_cast<int>(remaining)));
+            continue;
+        }
+
+        {
+            const ScopedLock sl(answersLock);
+            pendingAnswers.remove(0);
+            lastActivityTime = Time::getMillisecondCounterHiRes();
+        }
+        processor.processIncomingMidiData(entries.getReference(answer.entryIdx).message);
+    }
+
+    if (!threadShouldExit() && onReplayFinished)
+        onReplayFinished();
+}
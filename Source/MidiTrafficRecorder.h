@@ -0,0 +1,114 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#pragma once
+
+#include "MidiTransport.h"
+#include <atomic>
+#include <juce_audio_basics/juce_audio_basics.h>
+
+using namespace juce;
+
+class MidiSysexProcessor;
+
+// Records every MIDI message going in and out of the MidiSysexProcessor into a preallocated ring buffer.
+// Each entry is stored as: direction (1 byte), timestamp in microseconds since the recording started (8 bytes),
+// message size (2 bytes) and the raw message bytes. When the ring is full, the oldest entries are dropped.
+class MidiTrafficRecorder {
+  public:
+    enum Direction : uint8_t { INCOMING, OUTGOING };
+
+    struct Entry {
+        Direction direction;
+        int64 timestamp;
+        MidiMessage message;
+    };
+
+    static const size_t DEFAULT_CAPACITY = 4 * 1024 * 1024;
+
+    MidiTrafficRecorder(size_t capacity = DEFAULT_CAPACITY);
+
+    void start();
+    void stop();
+    bool isRecording() const { return recording.load(std::memory_order_relaxed); }
+
+    // Safe to call from the MIDI thread, this never allocates
+    void record(Direction direction, const MidiMessage& message);
+
+    bool saveToFile(const File& file);
+    static bool loadFromFile(const File& file, Array<Entry>& entries);
+
+  private:
+    static constexpr char FILE_MAGIC[4] = {'S', 'Q', 'K', 'R'};
+    static const int FILE_VERSION = 1;
+    static const size_t ENTRY_HEADER_SIZE = 1 + 8 + 2;
+
+    HeapBlock<uint8_t> ring;
+    const size_t capacity;
+    // Position of the oldest entry and the number of bytes currently used in the ring
+    size_t readPos = 0;
+    size_t usedBytes = 0;
+
+    std::atomic<bool> recording{false};
+    double startTime = 0.0;
+    SpinLock lock;
+
+    void writeBytes(size_t pos, const void* data, size_t size);
+    void readBytes(size_t pos, void* data, size_t size) const;
+    void dropOldestEntry();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiTrafficRecorder)
+};
+
+// Plays the synth's side of a recording to a MidiSysexProcessor, which uses it as its transport during the replay. Each time
+// the processor sends a message that was recorded, the answers that followed it in the recording come back with the same
+// delays, or shorter when replaying faster.
+class MidiTrafficReplayer : public MidiTransport, private Thread {
+  public:
+    MidiTrafficReplayer(MidiSysexProcessor& processor);
+    ~MidiTrafficReplayer() override;
+
+    bool load(const File& file);
+    // A speed of 1.0 replays at the original timing, 2.0 twice as fast, etc.
+    void startReplay(double speed);
+    void stopReplay();
+    bool isReplaying() const { return isThreadRunning(); }
+
+    // Called on the replay thread once every recorded answer was played, or when the processor stopped sending what was recorded
+    std::function<void()> onReplayFinished;
+
+    bool isOpen() const override { return true; }
+    void send(const MidiMessage& message) override;
+
+  private:
+    void run() override;
+    void scheduleAnswers(int requestIdx, double requestTime);
+
+    MidiSysexProcessor& processor;
+    Array<MidiTrafficRecorder::Entry> entries;
+    double replaySpeed = 1.0;
+
+    struct Answer {
+        int entryIdx;
+        double dueTime;
+    };
+    Array<Answer> pendingAnswers;
+    // Where the replay is in the recording, and when the processor last sent something it recognised
+    int nextEntryIdx = 0;
+    double lastActivityTime = 0.0;
+    CriticalSection answersLock;
+    static constexpr double IDLE_TIMEOUT = 5000.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiTrafficReplayer)
+};
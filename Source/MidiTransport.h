@@ -0,0 +1,30 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+using namespace juce;
+
+// Where a MidiSysexProcessor sends its messages: MIDI devices in the app, or anything else for the tools that drive the
+// processor without a GUI. The answers come back through MidiSysexProcessor::processIncomingMidiData.
+class MidiTransport {
+  public:
+    virtual ~MidiTransport() = default;
+
+    // False while there's nothing to send to, e.g. before a MIDI output is selected
+    virtual bool isOpen() const = 0;
+    virtual void send(const MidiMessage& message) = 0;
+};
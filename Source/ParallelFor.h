@@ -0,0 +1,49 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <functional>
+
+using namespace juce;
+
+inline int getNbOfParallelWorkers(int nbOfItems) { return jlimit(1, jmax(1, nbOfItems), SystemStats::getNumCpus()); }
+
+// Splits the items in one contiguous range per core, runs each range on its own thread and waits for all of them.
+// The worker number goes from 0 to getNbOfParallelWorkers(nbOfItems) - 1, for workers that fill their own results.
+inline void parallelFor(int nbOfItems, const std::function<void(int worker, int begin, int end)>& function) {
+    const int nbOfWorkers = getNbOfParallelWorkers(nbOfItems);
+    std::atomic<int> nbOfRunningWorkers{nbOfWorkers};
+    WaitableEvent workersDone;
+
+    for (int worker = 0; worker < nbOfWorkers; worker++) {
+        const int begin = nbOfItems * worker / nbOfWorkers;
+        const int end = nbOfItems * (worker + 1) / nbOfWorkers;
+        const bool launched = Thread::launch([&, worker, begin, end] {
+            function(worker, begin, end);
+            if (--nbOfRunningWorkers == 0)
+                workersDone.signal();
+        });
+
+        // Done on this thread instead
+        if (!launched) {
+            function(worker, begin, end);
+            if (--nbOfRunningWorkers == 0)
+                workersDone.signal();
+        }
+    }
+    workersDone.wait();
+}
@@ -0,0 +1,107 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#include "ParameterSequencer.h"
+
+using namespace juce;
+
+ParameterSequencer::ParameterSequencer(MidiSysexProcessor& processor) : processor(processor) {}
+
+ParameterSequencer::~ParameterSequencer() { stopTimer(); }
+
+bool ParameterSequencer::start(const Array<Step>& steps, double bpm, int stepsPerBeat, bool syncToMidiClock) {
+    stop();
+
+    auto currentProg = processor.getProgramToEdit(MidiSysexProcessor::FROM_CACHE);
+    if (steps.isEmpty() || currentProg.getSysExDataSize() != MidiSysexProcessor::SQ_ESQ_PROG_SIZE)
+        return false;
+
+    // Render all the programs up front, the timer callback only has to send them
+    renderedPrograms.clearQuick();
+    HeapBlock<uint8_t> progData(MidiSysexProcessor::SQ_ESQ_PROG_SIZE);
+    for (auto& step : steps) {
+        memcpy(progData.getData(), currentProg.getSysExData(), MidiSysexProcessor::SQ_ESQ_PROG_SIZE);
+        step(progData.getData());
+        renderedPrograms.add(MidiMessage::createSysExMessage(progData.getData(), MidiSysexProcessor::SQ_ESQ_PROG_SIZE));
+    }
+
+    // A step can't be shorter than the time it takes to send a program
+    stepInterval = jmax(60000.0 / (bpm * stepsPerBeat), processor.getProgramSendTimeMs());
+    clocksPerStep.store(jmax(1, CLOCKS_PER_BEAT / stepsPerBeat));
+    clockCount.store(0);
+    pendingClockSteps.store(0);
+    syncedToClock.store(syncToMidiClock);
+
+    currentStep = 0;
+    nbOfStepsSent.store(0);
+    totalJitter.store(0.0);
+    maxJitter.store(0.0);
+
+    nextStepTime = Time::getMillisecondCounterHiRes();
+    startTimer(1);
+    return true;
+}
+
+void ParameterSequencer::stop() { stopTimer(); }
+
+bool ParameterSequencer::handleClockMessage(const MidiMessage& message) {
+    // Without clock sync, the clock messages go on to the SysEx processing like any other
+    if (!syncedToClock.load(std::memory_order_relaxed))
+        return false;
+
+    if (message.isMidiStart()) {
+        clockCount.store(0);
+        return true;
+    }
+    if (!message.isMidiClock())
+        return false;
+
+    if (clockCount.fetch_add(1) % clocksPerStep.load(std::memory_order_relaxed) == 0) {
+        lastClockStepTime.store(Time::getMillisecondCounterHiRes());
+        pendingClockSteps.fetch_add(1);
+    }
+    return true;
+}
+
+void ParameterSequencer::hiResTimerCallback() {
+    if (syncedToClock.load()) {
+        // Steps are due on the clock pulses. If we fell behind, the late pulses are merged into one step.
+        if (pendingClockSteps.exchange(0) > 0)
+            sendStep(lastClockStepTime.load());
+    } else if (Time::getMillisecondCounterHiRes() >= nextStepTime) {
+        const auto scheduledTime = nextStepTime;
+        nextStepTime += stepInterval;
+        sendStep(scheduledTime);
+    }
+}
+
+void ParameterSequencer::sendStep(double scheduledTime) {
+    const auto jitter = Time::getMillisecondCounterHiRes() - scheduledTime;
+
+    processor.sendProgramMessage(renderedPrograms.getReference(currentStep));
+    currentStep = (currentStep + 1) % renderedPrograms.size();
+
+    nbOfStepsSent.fetch_add(1);
+    totalJitter.store(totalJitter.load() + jitter);
+    if (jitter > maxJitter.load())
+        maxJitter.store(jitter);
+}
+
+ParameterSequencer::JitterStats ParameterSequencer::getJitterStats() const {
+    JitterStats stats;
+    stats.nbOfSteps = nbOfStepsSent.load();
+    stats.meanJitterMs = stats.nbOfSteps > 0 ? totalJitter.load() / stats.nbOfSteps : 0.0;
+    stats.maxJitterMs = maxJitter.load();
+    return stats;
+}
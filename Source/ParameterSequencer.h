@@ -0,0 +1,72 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#pragma once
+
+#include "MidiSysexProcessor.h"
+#include <JuceHeader.h>
+#include <atomic>
+
+using namespace juce;
+
+// Sends a sequence of program edits in tempo, or locked to an incoming MIDI clock. Every step's program is rendered
+// before the sequence starts, so a step only costs the time it takes to send it. The timing jitter is measured on each step.
+class ParameterSequencer : private HighResolutionTimer {
+  public:
+    using Step = std::function<void(uint8_t* progData)>;
+
+    struct JitterStats {
+        int nbOfSteps = 0;
+        double meanJitterMs = 0.0;
+        double maxJitterMs = 0.0;
+    };
+
+    ParameterSequencer(MidiSysexProcessor& processor);
+    ~ParameterSequencer() override;
+
+    // Each step is applied to the current program. Returns false if the program could not be fetched from the synth.
+    bool start(const Array<Step>& steps, double bpm, int stepsPerBeat, bool syncToMidiClock);
+    void stop();
+    bool isRunning() const { return isTimerRunning(); }
+
+    // Called from the MIDI thread with every incoming message. Returns true if it was a MIDI clock message used for the clock sync.
+    bool handleClockMessage(const MidiMessage& message);
+
+    JitterStats getJitterStats() const;
+
+  private:
+    void hiResTimerCallback() override;
+    void sendStep(double scheduledTime);
+
+    MidiSysexProcessor& processor;
+    Array<MidiMessage> renderedPrograms;
+    int currentStep = 0;
+
+    double stepInterval = 0.0;
+    double nextStepTime = 0.0;
+
+    // MIDI clock runs at 24 pulses per quarter note
+    static const int CLOCKS_PER_BEAT = 24;
+    std::atomic<bool> syncedToClock{false};
+    std::atomic<int> clocksPerStep{6};
+    std::atomic<int> clockCount{0};
+    std::atomic<int> pendingClockSteps{0};
+    std::atomic<double> lastClockStepTime{0.0};
+
+    std::atomic<int> nbOfStepsSent{0};
+    std::atomic<double> totalJitter{0.0};
+    std::atomic<double> maxJitter{0.0};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ParameterSequencer)
+};
@@ -0,0 +1,111 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#include "PluginEditor.h"
+
+using namespace juce;
+
+SideQickPluginEditor::SideQickPluginEditor(SideQickPluginProcessor& processor) : AudioProcessorEditor(processor), pluginProcessor(processor) {
+    auto& parameters = pluginProcessor.parameters;
+
+    for (int osc = 0; osc < 3; osc++) {
+        const auto oscNumber = String(osc + 1);
+        oscLabels[osc].setText("OSC " + oscNumber, dontSendNotification);
+        addAndMakeVisible(oscLabels[osc]);
+
+        waveSliders[osc].setSliderStyle(Slider::IncDecButtons);
+        waveSliders[osc].setTooltip("Waveform for oscillator " + oscNumber + ". Values above the model's normal waves are hidden waves.");
+        addAndMakeVisible(waveSliders[osc]);
+        waveAttachments[osc] = std::make_unique<SliderAttachment>(parameters, "wave" + oscNumber, waveSliders[osc]);
+
+        // The items must be there before the attachment is made
+        octMenus[osc].addItemList(parameters.getParameter("oct" + oscNumber)->getAllValueStrings(), 1);
+        addAndMakeVisible(octMenus[osc]);
+        octAttachments[osc] = std::make_unique<ComboBoxAttachment>(parameters, "oct" + oscNumber, octMenus[osc]);
+
+        LFButtons[osc].setButtonText("LF");
+        addAndMakeVisible(LFButtons[osc]);
+        LFAttachments[osc] = std::make_unique<ButtonAttachment>(parameters, "lf" + oscNumber, LFButtons[osc]);
+    }
+
+    addAndMakeVisible(selfOscButton);
+    selfOscAttachment = std::make_unique<ButtonAttachment>(parameters, "selfOsc", selfOscButton);
+
+    channelSlider.setSliderStyle(Slider::IncDecButtons);
+    addAndMakeVisible(channelLabel);
+    addAndMakeVisible(channelSlider);
+    channelAttachment = std::make_unique<SliderAttachment>(parameters, "channel", channelSlider);
+
+    requestButton.onClick = [this] { pluginProcessor.requestProgramFromSynth(); };
+    addAndMakeVisible(requestButton);
+    loadButton.onClick = [this] { loadProgramFile(); };
+    addAndMakeVisible(loadButton);
+    addAndMakeVisible(statusLabel);
+
+    setSize(520, 230);
+    startTimer(250);
+}
+
+SideQickPluginEditor::~SideQickPluginEditor() { stopTimer(); }
+
+void SideQickPluginEditor::paint(Graphics& g) { g.fillAll(Colour::fromRGB(60, 60, 65)); }
+
+void SideQickPluginEditor::resized() {
+    for (int osc = 0; osc < 3; osc++) {
+        const int y = 15 + osc * 35;
+        oscLabels[osc].setBounds(15, y, 60, 25);
+        waveSliders[osc].setBounds(80, y, 150, 25);
+        octMenus[osc].setBounds(245, y, 110, 25);
+        LFButtons[osc].setBounds(370, y, 60, 25);
+    }
+    selfOscButton.setBounds(15, 125, 150, 25);
+    channelLabel.setBounds(245, 125, 100, 25);
+    channelSlider.setBounds(345, 125, 120, 25);
+    requestButton.setBounds(15, 160, 200, 25);
+    loadButton.setBounds(230, 160, 150, 25);
+    statusLabel.setBounds(15, 195, 490, 25);
+}
+
+void SideQickPluginEditor::timerCallback() {
+    const auto nbOfProgramsReceived = pluginProcessor.getNbOfProgramsReceived();
+    uint8_t progData[SideQickPluginProcessor::SQ_ESQ_PROG_SIZE];
+
+    if (nbOfProgramsReceived > 0)
+        statusLabel.setText(String(nbOfProgramsReceived) + " program(s) received from the synth", dontSendNotification);
+    else if (pluginProcessor.copyCurrentProgram(progData))
+        statusLabel.setText("Editing the program saved with the song", dontSendNotification);
+    else
+        statusLabel.setText("No program yet: route the synth's MIDI output to the plugin and get its program", dontSendNotification);
+}
+
+void SideQickPluginEditor::loadProgramFile() {
+    fileChooser = std::make_unique<FileChooser>("Load program", File::getSpecialLocation(File::userDocumentsDirectory), "*.syx");
+    fileChooser->launchAsync(FileBrowserComponent::openMode | FileBrowserComponent::canSelectFiles, [this](const FileChooser& chooser) {
+        auto file = chooser.getResult();
+        if (file == File())
+            return;
+
+        // A single program dump: F0, 0F 02 channel 01, the program nibbles and F7
+        MemoryBlock fileData;
+        const bool loaded = file.loadFileAsData(fileData) && fileData.getSize() == static_cast<size_t>(SideQickPluginProcessor::SQ_ESQ_PROG_SIZE + 2);
+        const auto* bytes = static_cast<const uint8_t*>(fileData.getData());
+        if (!loaded || bytes[0] != 0xF0 || bytes[1] != 0x0F || bytes[2] != 0x02 || bytes[4] != 0x01) {
+            AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "SideQick", file.getFileName() + " is not an SQ-80/ESQ-1 program dump");
+            return;
+        }
+
+        if (!pluginProcessor.queueProgram(bytes + 1, true))
+            AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "SideQick", "Too many programs are waiting to be sent, try again in a moment");
+    });
+}
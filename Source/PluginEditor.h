@@ -0,0 +1,60 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#pragma once
+
+#include "PluginProcessor.h"
+#include <JuceHeader.h>
+
+using namespace juce;
+
+class SideQickPluginEditor : public AudioProcessorEditor, private Timer {
+  public:
+    SideQickPluginEditor(SideQickPluginProcessor& processor);
+    ~SideQickPluginEditor() override;
+
+    void paint(Graphics& g) override;
+    void resized() override;
+
+  private:
+    void timerCallback() override;
+    void loadProgramFile();
+
+    SideQickPluginProcessor& pluginProcessor;
+
+    using SliderAttachment = AudioProcessorValueTreeState::SliderAttachment;
+    using ComboBoxAttachment = AudioProcessorValueTreeState::ComboBoxAttachment;
+    using ButtonAttachment = AudioProcessorValueTreeState::ButtonAttachment;
+
+    Label oscLabels[3];
+    Slider waveSliders[3];
+    ComboBox octMenus[3];
+    ToggleButton LFButtons[3];
+    ToggleButton selfOscButton{"Filter self-osc"};
+    Label channelLabel{{}, "MIDI channel"};
+    Slider channelSlider;
+
+    std::unique_ptr<SliderAttachment> waveAttachments[3];
+    std::unique_ptr<ComboBoxAttachment> octAttachments[3];
+    std::unique_ptr<ButtonAttachment> LFAttachments[3];
+    std::unique_ptr<ButtonAttachment> selfOscAttachment;
+    std::unique_ptr<SliderAttachment> channelAttachment;
+
+    TextButton requestButton{"Get program from synth"};
+    TextButton loadButton{"Load program..."};
+    Label statusLabel;
+    std::unique_ptr<FileChooser> fileChooser;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SideQickPluginEditor)
+};
@@ -0,0 +1,291 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#include "PluginProcessor.h"
+#include "PluginEditor.h"
+#include "ProgramParser.h"
+
+using namespace juce;
+
+const StringArray SideQickPluginProcessor::PARAMETER_IDS = {"wave1", "wave2", "wave3", "oct1", "oct2", "oct3", "lf1", "lf2", "lf3", "selfOsc"};
+
+SideQickPluginProcessor::SideQickPluginProcessor() : AudioProcessor(BusesProperties()), parameters(*this, nullptr, "SideQick", createParameterLayout()) {
+    memcpy(intButtonMsg, SysexMessages::INT_BUTTON, sizeof(intButtonMsg));
+    memcpy(requestPgmDumpMsg, SysexMessages::REQUEST_PGM_DUMP, sizeof(requestPgmDumpMsg));
+    memcpy(sb5Msg, SysexMessages::SB5, sizeof(sb5Msg));
+    for (int param = 0; param < NB_OF_PARAMETERS; param++) {
+        parameterValues[param] = parameters.getRawParameterValue(PARAMETER_IDS[param]);
+        lastParameterValues[param] = parameterValues[param]->load();
+    }
+    channelParameter = parameters.getRawParameterValue("channel");
+
+    for (auto& dueSample : dueSamples)
+        dueSample = -1;
+
+    startTimer(100);
+}
+
+SideQickPluginProcessor::~SideQickPluginProcessor() { stopTimer(); }
+
+AudioProcessorValueTreeState::ParameterLayout SideQickPluginProcessor::createParameterLayout() {
+    AudioProcessorValueTreeState::ParameterLayout layout;
+
+    for (int osc = 0; osc < 3; osc++)
+        layout.add(std::make_unique<AudioParameterInt>(ParameterID{PARAMETER_IDS[WAVE_OSC1 + osc], 1}, "OSC " + String(osc + 1) + " waveform", 0, 255, 0));
+    for (int osc = 0; osc < 3; osc++)
+        layout.add(std::make_unique<AudioParameterChoice>(ParameterID{PARAMETER_IDS[OCT_OSC1 + osc], 1}, "OSC " + String(osc + 1) + " octave",
+                                                          StringArray{"-3 to +5", "+6", "+7"}, 0));
+    for (int osc = 0; osc < 3; osc++)
+        layout.add(std::make_unique<AudioParameterBool>(ParameterID{PARAMETER_IDS[LF_OSC1 + osc], 1}, "OSC " + String(osc + 1) + " LF mode", false));
+    layout.add(std::make_unique<AudioParameterBool>(ParameterID{PARAMETER_IDS[SELF_OSC], 1}, "Filter self-osc", false));
+    layout.add(std::make_unique<AudioParameterInt>(ParameterID{"channel", 1}, "MIDI channel", 1, 16, 1));
+
+    return layout;
+}
+
+void SideQickPluginProcessor::prepareToPlay(double sampleRate, int samplesPerBlock) {
+    // Room for a whole block of incoming traffic and our own messages, so adding events never allocates
+    outgoingMidi.ensureSize(8192);
+
+    for (auto& dueSample : dueSamples)
+        dueSample = -1;
+    currentSample = 0;
+    lineFreeAtSample = 0;
+}
+
+int64 SideQickPluginProcessor::getWireTimeSamples(int nbOfBytes) const {
+    return static_cast<int64>(std::ceil(SysexMessages::getWireTimeMs(nbOfBytes) * getSampleRate() / 1000.0));
+}
+
+bool SideQickPluginProcessor::isProgramDump(const uint8_t* data, int size) const {
+    return size == SQ_ESQ_PROG_SIZE + 2 && data[0] == 0xF0 && data[1] == 0x0F && data[2] == 0x02 && data[4] == 0x01;
+}
+
+void SideQickPluginProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer& midiMessages) {
+    buffer.clear();
+    const auto nbOfSamples = buffer.getNumSamples();
+    const auto blockStart = currentSample;
+    outgoingMidi.clear();
+
+    // Program dumps from the synth become the program the edits are applied to, everything else goes through
+    bool programReplaced = false;
+    for (const auto metadata : midiMessages) {
+        if (isProgramDump(metadata.data, metadata.numBytes)) {
+            memcpy(currentProgram, metadata.data + 1, SQ_ESQ_PROG_SIZE);
+            hasProgram = true;
+            programReplaced = true;
+            nbOfProgramsReceived.fetch_add(1);
+        } else
+            outgoingMidi.addEvent(metadata.data, metadata.numBytes, metadata.samplePosition);
+    }
+
+    bool sendProgram = false;
+    programQueue.read(programQueue.getNumReady()).forEach([this, &sendProgram, &programReplaced](int slotIdx) {
+        memcpy(currentProgram, queuedPrograms[slotIdx].data, SQ_ESQ_PROG_SIZE);
+        hasProgram = true;
+        programReplaced = true;
+        sendProgram |= queuedPrograms[slotIdx].sendToSynth;
+    });
+    sendProgram |= applyParameterChanges();
+
+    if (sendProgram)
+        scheduleProgramSend(blockStart);
+    if (hasProgram)
+        publishCurrentProgram();
+    // The host's parameters follow the new program, with the edits made to it
+    if (programReplaced)
+        parametersToSync.store(true);
+    if (programRequested.exchange(false))
+        scheduleDumpRequest(blockStart);
+
+    emitDueMessages(blockStart, nbOfSamples);
+
+    midiMessages.clear();
+    midiMessages.addEvents(outgoingMidi, 0, -1, 0);
+    currentSample += nbOfSamples;
+}
+
+bool SideQickPluginProcessor::applyParameterChanges() {
+    // Edits need a program to be applied to. The values changed until then are applied to the first program that arrives.
+    if (!hasProgram)
+        return false;
+
+    bool programChanged = false;
+
+    for (int param = 0; param < NB_OF_PARAMETERS; param++) {
+        const auto value = parameterValues[param]->load(std::memory_order_relaxed);
+        if (value == lastParameterValues[param])
+            continue;
+        lastParameterValues[param] = value;
+
+        // Nothing to send when the program already has the value, as it does after the parameters were synced to it
+        if (value == getParameterValueInProgram(currentProgram, param, value))
+            continue;
+        programChanged = true;
+
+        const auto intValue = roundToInt(value);
+        if (param <= WAVE_OSC3)
+            ProgramParser::setNibblePair(currentProgram, ProgramParser::WAVE[param - WAVE_OSC1], intValue);
+        else if (param <= OCT_OSC3) {
+            const int osc = param - OCT_OSC1;
+            // Going back to the normal range puts the oscillator at OCT+5
+            const int currentOctave = ProgramParser::getNibblePair(currentProgram, ProgramParser::PITCH[osc]) / 12 - 3;
+            ProgramParser::setOctave(currentProgram, osc, intValue > 0 ? 5 + intValue : jmin(currentOctave, 5));
+        } else if (param <= LF_OSC3)
+            ProgramParser::setLowFrequencyRange(currentProgram, param - LF_OSC1, intValue != 0);
+        else
+            ProgramParser::setSelfOscillation(currentProgram, intValue != 0);
+    }
+    return programChanged;
+}
+
+float SideQickPluginProcessor::getParameterValueInProgram(const uint8_t* progData, int param, float currentValue) {
+    if (param <= WAVE_OSC3)
+        return static_cast<float>(ProgramParser::getNibblePair(progData, ProgramParser::WAVE[param - WAVE_OSC1]));
+
+    if (param <= LF_OSC3) {
+        const int osc = param <= OCT_OSC3 ? param - OCT_OSC1 : param - LF_OSC1;
+        const int totalNbSemi = ProgramParser::getNibblePair(progData, ProgramParser::PITCH[osc]);
+        const bool lowFreq = totalNbSemi > ProgramParser::MAX_SEMI_NORMAL_RANGE;
+        if (param >= LF_OSC1)
+            return lowFreq ? 1.0f : 0.0f;
+        if (lowFreq)
+            return currentValue;
+        // The choices are -3 to +5, +6 and +7
+        return static_cast<float>(jlimit(0, 2, totalNbSemi / 12 - 3 - 5));
+    }
+
+    return progData[ProgramParser::RES[1]] > 1 ? 1.0f : 0.0f;
+}
+
+void SideQickPluginProcessor::timerCallback() {
+    uint8_t progData[SQ_ESQ_PROG_SIZE];
+    if (!parametersToSync.exchange(false) || !copyCurrentProgram(progData))
+        return;
+
+    for (int param = 0; param < NB_OF_PARAMETERS; param++) {
+        const auto currentValue = parameterValues[param]->load();
+        const auto programValue = getParameterValueInProgram(progData, param, currentValue);
+        if (programValue != currentValue) {
+            auto* parameter = parameters.getParameter(PARAMETER_IDS[param]);
+            parameter->setValueNotifyingHost(parameter->convertTo0to1(programValue));
+        }
+    }
+}
+
+void SideQickPluginProcessor::scheduleProgramSend(int64 blockStart) {
+    // If the last program is still waiting for the line, it will simply go out with the newest data
+    if (dueSamples[PROGRAM] >= 0)
+        return;
+
+    dueSamples[INT_BUTTON] = jmax(lineFreeAtSample, blockStart);
+    dueSamples[PROGRAM] = dueSamples[INT_BUTTON] + getWireTimeSamples(sizeof(intButtonMsg));
+    dueSamples[SB5] = dueSamples[PROGRAM] + getWireTimeSamples(sizeof(programMsg));
+    lineFreeAtSample = dueSamples[SB5] + getWireTimeSamples(sizeof(sb5Msg)) + roundToInt(SysexMessages::SYNTH_PROCESSING_TIME_MS * getSampleRate() / 1000.0);
+}
+
+void SideQickPluginProcessor::scheduleDumpRequest(int64 blockStart) {
+    if (dueSamples[DUMP_REQUEST] >= 0)
+        return;
+
+    // The synth is busy answering until its program has gone through the line
+    dueSamples[DUMP_REQUEST] = jmax(lineFreeAtSample, blockStart);
+    lineFreeAtSample = dueSamples[DUMP_REQUEST] + getWireTimeSamples(sizeof(requestPgmDumpMsg) + sizeof(programMsg)) +
+                       roundToInt(SysexMessages::SYNTH_PROCESSING_TIME_MS * getSampleRate() / 1000.0);
+}
+
+void SideQickPluginProcessor::emitDueMessages(int64 blockStart, int nbOfSamples) {
+    const auto channel = static_cast<uint8_t>(jlimit(1, 16, roundToInt(channelParameter->load())) - 1);
+
+    for (int message = 0; message < NB_OF_OUTGOING_MESSAGES; message++) {
+        if (dueSamples[message] < 0 || dueSamples[message] >= blockStart + nbOfSamples)
+            continue;
+        const auto sampleOffset = static_cast<int>(dueSamples[message] - blockStart);
+        dueSamples[message] = -1;
+
+        if (message == INT_BUTTON) {
+            intButtonMsg[CHANNEL_IDX] = channel;
+            outgoingMidi.addEvent(intButtonMsg, sizeof(intButtonMsg), sampleOffset);
+        } else if (message == PROGRAM) {
+            // The program is copied when it goes out, so it includes every edit made while it was waiting
+            programMsg[0] = 0xF0;
+            memcpy(programMsg + 1, currentProgram, SQ_ESQ_PROG_SIZE);
+            programMsg[1 + PROG_CHANNEL_IDX] = channel;
+            programMsg[SQ_ESQ_PROG_SIZE + 1] = 0xF7;
+            outgoingMidi.addEvent(programMsg, sizeof(programMsg), sampleOffset);
+        } else if (message == SB5) {
+            sb5Msg[CHANNEL_IDX] = channel;
+            outgoingMidi.addEvent(sb5Msg, sizeof(sb5Msg), sampleOffset);
+        } else if (message == DUMP_REQUEST) {
+            requestPgmDumpMsg[CHANNEL_IDX] = channel;
+            outgoingMidi.addEvent(requestPgmDumpMsg, sizeof(requestPgmDumpMsg), sampleOffset);
+        }
+    }
+}
+
+void SideQickPluginProcessor::publishCurrentProgram() {
+    const SpinLock::ScopedTryLockType sl(publishedProgramLock);
+    if (sl.isLocked()) {
+        memcpy(publishedProgram, currentProgram, SQ_ESQ_PROG_SIZE);
+        hasPublishedProgram = true;
+    }
+}
+
+bool SideQickPluginProcessor::queueProgram(const uint8_t* progData, bool sendToSynth) {
+    const auto scope = programQueue.write(1);
+    if (scope.blockSize1 + scope.blockSize2 == 0)
+        return false;
+
+    auto& slot = queuedPrograms[scope.blockSize1 > 0 ? scope.startIndex1 : scope.startIndex2];
+    memcpy(slot.data, progData, SQ_ESQ_PROG_SIZE);
+    slot.sendToSynth = sendToSynth;
+    return true;
+}
+
+bool SideQickPluginProcessor::copyCurrentProgram(uint8_t* progData) {
+    const SpinLock::ScopedLockType sl(publishedProgramLock);
+    if (hasPublishedProgram)
+        memcpy(progData, publishedProgram, SQ_ESQ_PROG_SIZE);
+    return hasPublishedProgram;
+}
+
+void SideQickPluginProcessor::getStateInformation(MemoryBlock& destData) {
+    auto xml = parameters.copyState().createXml();
+
+    // The program is saved with the song, so the edits are applied to the same program when it's opened again
+    uint8_t progData[SQ_ESQ_PROG_SIZE];
+    if (copyCurrentProgram(progData))
+        xml->setAttribute("program", String::toHexString(progData, SQ_ESQ_PROG_SIZE, 0));
+
+    copyXmlToBinary(*xml, destData);
+}
+
+void SideQickPluginProcessor::setStateInformation(const void* data, int sizeInBytes) {
+    auto xml = getXmlFromBinary(data, sizeInBytes);
+    if (xml == nullptr || !xml->hasTagName(parameters.state.getType()))
+        return;
+
+    MemoryBlock program;
+    program.loadFromHexString(xml->getStringAttribute("program"));
+    xml->removeAttribute("program");
+    parameters.replaceState(ValueTree::fromXml(*xml));
+
+    if (program.getSize() == static_cast<size_t>(SQ_ESQ_PROG_SIZE))
+        queueProgram(static_cast<const uint8_t*>(program.getData()), false);
+}
+
+AudioProcessorEditor* SideQickPluginProcessor::createEditor() { return new SideQickPluginEditor(*this); }
+
+// This creates new instances of the plugin
+AudioProcessor* JUCE_CALLTYPE createPluginFilter() { return new SideQickPluginProcessor(); }
@@ -0,0 +1,123 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#pragma once
+
+#include "SysexMessages.h"
+#include <JuceHeader.h>
+#include <atomic>
+
+using namespace juce;
+
+// SideQick as a MIDI effect plugin. The illegal values are automatable parameters, and every edit is placed in the plugin's
+// MIDI output at the sample where the MIDI line is free, instead of being sent right away. Nothing on the audio thread
+// allocates or waits: programs live in preallocated buffers, and the editor hands its programs over through a lock-free FIFO.
+class SideQickPluginProcessor : public AudioProcessor, private Timer {
+  public:
+    static constexpr int SQ_ESQ_PROG_SIZE = SysexMessages::PROG_SIZE;
+
+    SideQickPluginProcessor();
+    ~SideQickPluginProcessor() override;
+
+    void prepareToPlay(double sampleRate, int samplesPerBlock) override;
+    void releaseResources() override {}
+    void processBlock(AudioBuffer<float>& buffer, MidiBuffer& midiMessages) override;
+
+    AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override { return true; }
+
+    const String getName() const override { return "SideQick"; }
+    bool acceptsMidi() const override { return true; }
+    bool producesMidi() const override { return true; }
+    bool isMidiEffect() const override { return true; }
+    double getTailLengthSeconds() const override { return 0.0; }
+
+    int getNumPrograms() override { return 1; }
+    int getCurrentProgram() override { return 0; }
+    void setCurrentProgram(int) override {}
+    const String getProgramName(int) override { return {}; }
+    void changeProgramName(int, const String&) override {}
+
+    void getStateInformation(MemoryBlock& destData) override;
+    void setStateInformation(const void* data, int sizeInBytes) override;
+
+    // Called from the editor. The program is sent on the next block, unless it only replaces the program the edits are applied to.
+    bool queueProgram(const uint8_t* progData, bool sendToSynth);
+    void requestProgramFromSynth() { programRequested.store(true); }
+    // Copies the last program received from or sent to the synth. Returns false if there is none yet.
+    bool copyCurrentProgram(uint8_t* progData);
+    int getNbOfProgramsReceived() const { return nbOfProgramsReceived.load(); }
+
+    AudioProcessorValueTreeState parameters;
+
+  private:
+    static AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+
+    struct ProgramSlot {
+        uint8_t data[SQ_ESQ_PROG_SIZE];
+        bool sendToSynth;
+    };
+
+    enum OutgoingMessages { INT_BUTTON, PROGRAM, SB5, DUMP_REQUEST, NB_OF_OUTGOING_MESSAGES };
+    enum Parameters { WAVE_OSC1, WAVE_OSC2, WAVE_OSC3, OCT_OSC1, OCT_OSC2, OCT_OSC3, LF_OSC1, LF_OSC2, LF_OSC3, SELF_OSC, NB_OF_PARAMETERS };
+    static const StringArray PARAMETER_IDS;
+
+    bool isProgramDump(const uint8_t* data, int size) const;
+    bool applyParameterChanges();
+    // Value of a parameter in the program, or currentValue if the program has none for it (the octave in the low-frequency range)
+    static float getParameterValueInProgram(const uint8_t* progData, int param, float currentValue);
+    // Sets the parameters to the program received, on the message thread
+    void timerCallback() override;
+    void scheduleProgramSend(int64 blockStart);
+    void scheduleDumpRequest(int64 blockStart);
+    void emitDueMessages(int64 blockStart, int nbOfSamples);
+    void publishCurrentProgram();
+    int64 getWireTimeSamples(int nbOfBytes) const;
+
+    // Copies of the SysexMessages templates, the channel is set when they are sent
+    uint8_t intButtonMsg[sizeof(SysexMessages::INT_BUTTON)];
+    uint8_t requestPgmDumpMsg[sizeof(SysexMessages::REQUEST_PGM_DUMP)];
+    uint8_t sb5Msg[sizeof(SysexMessages::SB5)];
+    static constexpr int CHANNEL_IDX = SysexMessages::CHANNEL_IDX;
+    // Index of the channel in the program data, which has no SysEx header
+    static const int PROG_CHANNEL_IDX = 2;
+
+    // Audio thread only
+    uint8_t currentProgram[SQ_ESQ_PROG_SIZE] = {};
+    bool hasProgram = false;
+    // The whole program message with its SysEx header and footer, rebuilt when it's emitted
+    uint8_t programMsg[SQ_ESQ_PROG_SIZE + 2] = {};
+    int64 dueSamples[NB_OF_OUTGOING_MESSAGES];
+    int64 lineFreeAtSample = 0;
+    int64 currentSample = 0;
+    float lastParameterValues[NB_OF_PARAMETERS];
+    std::atomic<float>* parameterValues[NB_OF_PARAMETERS] = {};
+    std::atomic<float>* channelParameter = nullptr;
+    MidiBuffer outgoingMidi;
+
+    // From the editor to the audio thread
+    static const int PROGRAM_QUEUE_SIZE = 8;
+    AbstractFifo programQueue{PROGRAM_QUEUE_SIZE};
+    ProgramSlot queuedPrograms[PROGRAM_QUEUE_SIZE];
+    std::atomic<bool> programRequested{false};
+
+    // From the audio thread to the editor and the saved state. The audio thread only tries the lock and skips the update if it's taken.
+    SpinLock publishedProgramLock;
+    uint8_t publishedProgram[SQ_ESQ_PROG_SIZE] = {};
+    bool hasPublishedProgram = false;
+    std::atomic<int> nbOfProgramsReceived{0};
+    std::atomic<bool> parametersToSync{false};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SideQickPluginProcessor)
+};
@@ -0,0 +1,264 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#include "MidiSysexProcessor.h"
+#include "ProgramParser.h"
+#include <JuceHeader.h>
+
+using namespace juce;
+
+// Checks the properties of the program encoding over every value of each field, then measures how fast programs are decoded,
+// encoded and edited, so the codecs can be compared from one version to the next:
+//     SideQickCodecBench [number of iterations]
+// Returns 1 if a property doesn't hold. The edits go through a MidiSysexProcessor connected to a simulated synth, without the wire time.
+
+namespace {
+const int PROG_SIZE = MidiSysexProcessor::SQ_ESQ_PROG_SIZE;
+
+// Answers the dump requests with the last program it received, as the synth does
+class SimulatedSynth : public MidiTransport {
+  public:
+    MidiSysexProcessor* processor = nullptr;
+    uint8_t program[PROG_SIZE];
+
+    bool isOpen() const override { return true; }
+    void send(const MidiMessage& message) override {
+        const auto* data = message.getSysExData();
+        const auto size = message.getSysExDataSize();
+        if (size == PROG_SIZE && data[3] == 0x01)
+            memcpy(program, data, PROG_SIZE);
+        else if (size == 4 && data[3] == 0x09 && processor != nullptr)
+            processor->processIncomingMidiData(MidiMessage::createSysExMessage(program, PROG_SIZE));
+    }
+};
+
+int nbOfChecks = 0;
+int nbOfFailures = 0;
+
+void check(bool holds, const String& property, int value) {
+    nbOfChecks++;
+    if (!holds && ++nbOfFailures <= 20)
+        std::cerr << "FAILED: " << property << " for " << value << std::endl;
+}
+
+void fillRandomProgram(uint8_t* progData, Random& random) {
+    progData[0] = 0x0F;
+    progData[1] = 0x02;
+    progData[2] = 0x00;
+    progData[3] = 0x01;
+    for (int nibbleIdx = ProgramParser::PROG_HEADER_SIZE; nibbleIdx < PROG_SIZE; nibbleIdx++)
+        progData[nibbleIdx] = static_cast<uint8_t>(random.nextInt(16));
+}
+
+// True if only the nibbles of the field changed, and they are still nibbles
+bool onlyFieldChanged(const uint8_t* before, const uint8_t* after, const int nibbleIdx[2]) {
+    for (int idx = 0; idx < PROG_SIZE; idx++)
+        if ((idx == nibbleIdx[0] || idx == nibbleIdx[1]) ? after[idx] > 0x0F : after[idx] != before[idx])
+            return false;
+    return true;
+}
+
+void checkNibblePairs(Random& random) {
+    uint8_t progData[PROG_SIZE], original[PROG_SIZE];
+    fillRandomProgram(original, random);
+
+    Array<const int*> fields{ProgramParser::RES};
+    for (int osc = 0; osc < 3; osc++)
+        fields.addArray({ProgramParser::WAVE[osc], ProgramParser::PITCH[osc]});
+
+    for (auto* field : fields)
+        for (int value = 0; value < 256; value++) {
+            memcpy(progData, original, PROG_SIZE);
+            ProgramParser::setNibblePair(progData, field, value);
+            check(ProgramParser::getNibblePair(progData, field) == value, "the nibble pair at " + String(field[0]) + " reads back", value);
+            check(onlyFieldChanged(original, progData, field), "the nibble pair at " + String(field[0]) + " leaves the rest alone", value);
+        }
+}
+
+void checkDecoding(Random& random) {
+    uint8_t progData[PROG_SIZE];
+    fillRandomProgram(progData, random);
+
+    for (int osc = 0; osc < 3; osc++)
+        for (int value = 0; value < 256; value++) {
+            ProgramParser::setNibblePair(progData, ProgramParser::WAVE[osc], value);
+            ProgramParser::setNibblePair(progData, ProgramParser::PITCH[osc], value);
+            const auto program = MidiMessage::createSysExMessage(progData, PROG_SIZE);
+
+            // The waves past the model's list are its hidden waves, numbered from 1
+            for (auto model : {SQ80, ESQ1}) {
+                const auto nbOfWaves = static_cast<int>(NB_OF_WAVES[model]);
+                const ProgramParser parser(program, model);
+                check(parser.currentWave[osc] == (value < nbOfWaves ? 0 : value - nbOfWaves + 1), MODEL_NAMES[model] + " hidden wave numbering", value);
+            }
+
+            // Above MAX_SEMI_NORMAL_RANGE the oscillator is in the low-frequency range, where the octaves start 4 semitones lower
+            const ProgramParser parser(program, SQ80);
+            const bool lowFreq = value > ProgramParser::MAX_SEMI_NORMAL_RANGE;
+            check(parser.currentOscLF[osc] == lowFreq, "LF range detection", value);
+            check(parser.currentSemi[osc] == value, "total semitones", value);
+            check(isPositiveAndBelow(parser.currentRealSemi[osc], 12), "semitone within the octave", value);
+            check(parser.currentRealOct[osc] * 12 + parser.currentRealSemi[osc] == value + (lowFreq ? 4 : 0), "octave and semitone add up to the pitch", value);
+        }
+
+    for (int value = 0; value < 256; value++) {
+        ProgramParser::setNibblePair(progData, ProgramParser::RES, value);
+        const ProgramParser parser(MidiMessage::createSysExMessage(progData, PROG_SIZE), SQ80);
+        check(parser.currentSelfOsc == (value >= 32), "self-oscillation from 32", value);
+    }
+}
+
+void checkStaticEdits(Random& random) {
+    uint8_t progData[PROG_SIZE], original[PROG_SIZE];
+    fillRandomProgram(original, random);
+
+    for (int value = 0; value < 256; value++)
+        for (int osc = 0; osc < 3; osc++) {
+            memcpy(progData, original, PROG_SIZE);
+            ProgramParser::setNibblePair(progData, ProgramParser::PITCH[osc], value);
+            const bool lowFreq = value > ProgramParser::MAX_SEMI_NORMAL_RANGE;
+
+            ProgramParser::setLowFrequencyRange(progData, osc, !lowFreq);
+            check((ProgramParser::getNibblePair(progData, ProgramParser::PITCH[osc]) > ProgramParser::MAX_SEMI_NORMAL_RANGE) != lowFreq, "LF range toggles", value);
+            ProgramParser::setLowFrequencyRange(progData, osc, lowFreq);
+            check(ProgramParser::getNibblePair(progData, ProgramParser::PITCH[osc]) == value, "LF range round trip", value);
+
+            // Only the normal range has octaves to move between
+            if (!lowFreq)
+                for (int octave = -3; octave <= 5; octave++) {
+                    ProgramParser::setOctave(progData, osc, octave);
+                    const ProgramParser parser(MidiMessage::createSysExMessage(progData, PROG_SIZE), SQ80);
+                    check(parser.currentRealOct[osc] == octave + 3 && parser.currentRealSemi[osc] == value % 12, "octave change keeps the semitone", value);
+                }
+        }
+
+    for (int value = 0; value < 256; value++) {
+        memcpy(progData, original, PROG_SIZE);
+        ProgramParser::setNibblePair(progData, ProgramParser::RES, value);
+        const bool selfOsc = progData[ProgramParser::RES[1]] > 1;
+
+        ProgramParser::setSelfOscillation(progData, !selfOsc);
+        check(onlyFieldChanged(original, progData, ProgramParser::RES), "self-oscillation toggle leaves the rest alone", value);
+        // Past 63 the resonance isn't a value the synth uses, there is no range to toggle between
+        if (value < 64)
+            check((progData[ProgramParser::RES[1]] > 1) != selfOsc, "self-oscillation toggles", value);
+        ProgramParser::setSelfOscillation(progData, selfOsc);
+        if (value < 64)
+            check(ProgramParser::getNibblePair(progData, ProgramParser::RES) == value, "self-oscillation round trip", value);
+    }
+}
+
+void checkProcessorEdits(MidiSysexProcessor& processor, SimulatedSynth& synth, Random& random) {
+    uint8_t original[PROG_SIZE];
+    fillRandomProgram(original, random);
+
+    for (int osc = 0; osc < 3; osc++)
+        for (int value = 0; value < 256; value++) {
+            memcpy(synth.program, original, PROG_SIZE);
+            processor.changeOscWaveform(osc, value);
+            check(ProgramParser::getNibblePair(synth.program, ProgramParser::WAVE[osc]) == value, "the synth gets the wave", value);
+            check(onlyFieldChanged(original, synth.program, ProgramParser::WAVE[osc]), "the wave change leaves the rest alone", value);
+
+            memcpy(synth.program, original, PROG_SIZE);
+            ProgramParser::setNibblePair(synth.program, ProgramParser::PITCH[osc], value);
+            processor.toggleLowFrequencyMode(osc, true);
+            check(ProgramParser::getNibblePair(synth.program, ProgramParser::PITCH[osc]) > ProgramParser::MAX_SEMI_NORMAL_RANGE, "the synth goes to the LF range", value);
+            processor.toggleLowFrequencyMode(osc, false);
+            const auto pitch = ProgramParser::getNibblePair(synth.program, ProgramParser::PITCH[osc]);
+            check(pitch <= ProgramParser::MAX_SEMI_NORMAL_RANGE, "the synth comes back to the normal range", value);
+            if (value <= ProgramParser::MAX_SEMI_NORMAL_RANGE)
+                check(pitch == value, "the synth gets its pitch back after LF", value);
+        }
+
+    for (int value = 0; value < 256; value++) {
+        memcpy(synth.program, original, PROG_SIZE);
+        ProgramParser::setNibblePair(synth.program, ProgramParser::RES, value);
+        processor.toggleSelfOscillation(true);
+        check(synth.program[ProgramParser::RES[1]] > 1, "the synth self-oscillates", value);
+        processor.toggleSelfOscillation(false);
+        check(ProgramParser::getNibblePair(synth.program, ProgramParser::RES) == value, "the synth gets its resonance back", value);
+    }
+}
+
+template <typename Function>
+void measure(const String& name, int nbOfOperations, Function&& function) {
+    const auto startTime = Time::getMillisecondCounterHiRes();
+    function();
+    const auto duration = jmax(0.001, Time::getMillisecondCounterHiRes() - startTime);
+    std::cout << name << ": " << String(nbOfOperations * 1000.0 / duration, 0) << "/s (" << String(duration, 1) << " ms)" << std::endl;
+}
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const int nbOfIterations = argc > 1 ? jmax(1, String(argv[1]).getIntValue()) : 100000;
+    // Always the same programs, so the runs can be compared
+    Random random(0x5051);
+
+    SimulatedSynth synth;
+    MidiSysexProcessor processor(synth);
+    synth.processor = &processor;
+
+    checkNibblePairs(random);
+    checkDecoding(random);
+    checkStaticEdits(random);
+    checkProcessorEdits(processor, synth, random);
+    std::cout << nbOfChecks - nbOfFailures << "/" << nbOfChecks << " property checks passed" << std::endl;
+
+    // A bank worth of different programs, decoded and encoded in turn
+    HeapBlock<uint8_t> programs(ProgramParser::NB_OF_PROGS_IN_BANK * PROG_SIZE);
+    Array<MidiMessage> messages;
+    for (int programIdx = 0; programIdx < ProgramParser::NB_OF_PROGS_IN_BANK; programIdx++) {
+        fillRandomProgram(programs + programIdx * PROG_SIZE, random);
+        messages.add(MidiMessage::createSysExMessage(programs + programIdx * PROG_SIZE, PROG_SIZE));
+    }
+
+    // Keeps the compiler from optimising the work away
+    int64 checksum = 0;
+
+    measure("Decode (ProgramParser)", nbOfIterations, [&] {
+        for (int iteration = 0; iteration < nbOfIterations; iteration++) {
+            const ProgramParser parser(messages.getReference(iteration % messages.size()), SQ80);
+            checksum += parser.currentWave[0] + parser.currentSemi[1] + parser.currentSelfOsc;
+        }
+    });
+
+    measure("Encode (nibble pairs)", nbOfIterations, [&] {
+        for (int iteration = 0; iteration < nbOfIterations; iteration++) {
+            auto* progData = programs + (iteration % ProgramParser::NB_OF_PROGS_IN_BANK) * PROG_SIZE;
+            for (int osc = 0; osc < 3; osc++) {
+                ProgramParser::setNibblePair(progData, ProgramParser::WAVE[osc], iteration & 0xFF);
+                ProgramParser::setNibblePair(progData, ProgramParser::PITCH[osc], (iteration >> 8) & 0xFF);
+            }
+            ProgramParser::setNibblePair(progData, ProgramParser::RES, iteration & 0x3F);
+            checksum += progData[ProgramParser::RES[0]];
+        }
+    });
+
+    measure("Encode (SysEx message)", nbOfIterations, [&] {
+        for (int iteration = 0; iteration < nbOfIterations; iteration++)
+            checksum += MidiMessage::createSysExMessage(programs + (iteration % ProgramParser::NB_OF_PROGS_IN_BANK) * PROG_SIZE, PROG_SIZE).getRawDataSize();
+    });
+
+    // The edits take the program the processor last sent, as the ones from the UI and the remote control do
+    const int nbOfEdits = jmax(1, nbOfIterations / 10);
+    memcpy(synth.program, programs.getData(), PROG_SIZE);
+    processor.requestProgramDump(0);
+    measure("Edit (MidiSysexProcessor)", nbOfEdits, [&] {
+        for (int iteration = 0; iteration < nbOfEdits; iteration++)
+            checksum += processor.changeOscWaveform(iteration % 3, iteration & 0xFF, MidiSysexProcessor::FROM_CACHE).status;
+    });
+
+    std::cout << "Checksum " << checksum << std::endl;
+    return nbOfFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#include "ProgramLibrary.h"
+#include "DiskImage.h"
+#include "MidiSysexProcessor.h"
+#include "ParallelFor.h"
+#include "ProgramParser.h"
+
+using namespace juce;
+
+ProgramLibrary::Query& ProgramLibrary::Query::whereAny(std::initializer_list<Column> columnList, int minValue, int maxValue) {
+    Condition condition;
+    for (auto column : columnList)
+        condition.columns |= 1u << column;
+    condition.minValue = static_cast<uint8_t>(jlimit(0, 255, minValue));
+    condition.maxValue = static_cast<uint8_t>(jlimit(0, 255, maxValue));
+    conditions.add(condition);
+    return *this;
+}
+
+void ProgramLibrary::forEachDumpInData(const uint8_t* bytes, int nbOfBytes, const std::function<void(const uint8_t* sysexData, int size)>& callback) {
+    for (int messageStart = 0; messageStart < nbOfBytes; messageStart++) {
+        if (bytes[messageStart] != 0xF0)
+            continue;
+        int messageEnd = messageStart + 1;
+        while (messageEnd < nbOfBytes && bytes[messageEnd] != 0xF7)
+            messageEnd++;
+        if (messageEnd == nbOfBytes)
+            break;
+
+        const auto* sysexData = bytes + messageStart + 1;
+        const auto sysexSize = messageEnd - messageStart - 1;
+        if ((sysexSize == MidiSysexProcessor::SQ_ESQ_PROG_SIZE && sysexData[0] == 0x0F && sysexData[1] == 0x02 && sysexData[3] == 0x01) ||
+            ProgramParser::isBankDump(sysexData, sysexSize))
+            callback(sysexData, sysexSize);
+        messageStart = messageEnd;
+    }
+}
+
+bool ProgramLibrary::forEachProgramInFile(const File& file, const std::function<void(const uint8_t* progData, int position)>& callback) {
+    int position = 0;
+    const auto forEachProgramInDump = [&callback, &position](const uint8_t* sysexData, int size) {
+        if (!ProgramParser::isBankDump(sysexData, size)) {
+            callback(sysexData, position++);
+            return;
+        }
+        uint8_t progData[MidiSysexProcessor::SQ_ESQ_PROG_SIZE];
+        for (int programIdx = 0; programIdx < ProgramParser::NB_OF_PROGS_IN_BANK; programIdx++) {
+            ProgramParser::extractProgram(sysexData, programIdx, progData);
+            callback(progData, position++);
+        }
+    };
+
+    // Disk images are read in place, the programs are numbered across all the files of the disk
+    if (DiskImage::isDiskImage(file)) {
+        DiskImage image(file);
+        if (!image.isOpen())
+            return false;
+        image.forEachDump([&forEachProgramInDump](const DiskImage::Entry&, const uint8_t* sysexData, int size) { forEachProgramInDump(sysexData, size); });
+        return true;
+    }
+
+    MemoryBlock fileData;
+    if (!file.loadFileAsData(fileData))
+        return false;
+    forEachDumpInData(static_cast<const uint8_t*>(fileData.getData()), static_cast<int>(fileData.getSize()), forEachProgramInDump);
+    return true;
+}
+
+int ProgramLibrary::addFolder(const File& folder) { return addFiles(folder.findChildFiles(File::findFiles, true, "*.syx;" + DiskImage::FILE_PATTERNS)); }
+
+int ProgramLibrary::addFiles(const Array<File>& files) {
+    if (files.isEmpty())
+        return 0;
+
+    // Each worker decodes into its own columns, which are appended to the library once everything is loaded
+    struct WorkerColumns {
+        Array<uint8_t> columns[NB_OF_COLUMNS];
+        Array<int> fileIndexes;
+        Array<int> positions;
+    };
+
+    OwnedArray<WorkerColumns> workerColumns;
+    for (int worker = 0; worker < getNbOfParallelWorkers(files.size()); worker++)
+        workerColumns.add(new WorkerColumns());
+
+    parallelFor(files.size(), [&](int worker, int begin, int end) {
+        auto* decoded = workerColumns[worker];
+        for (int fileIdx = begin; fileIdx < end; fileIdx++) {
+            forEachProgramInFile(files[fileIdx], [decoded, fileIdx](const uint8_t* progData, int position) {
+                for (int osc = 0; osc < 3; osc++) {
+                    decoded->columns[WAVE_OSC1 + osc].add(static_cast<uint8_t>(ProgramParser::getNibblePair(progData, ProgramParser::WAVE[osc])));
+                    decoded->columns[PITCH_OSC1 + osc].add(static_cast<uint8_t>(ProgramParser::getNibblePair(progData, ProgramParser::PITCH[osc])));
+                }
+                decoded->columns[RESONANCE].add(static_cast<uint8_t>(ProgramParser::getNibblePair(progData, ProgramParser::RES)));
+                decoded->fileIndexes.add(fileIdx);
+                decoded->positions.add(position);
+            });
+        }
+    });
+
+    const ScopedWriteLock sl(libraryLock);
+    const int firstFileIdx = sourceFiles.size();
+    sourceFiles.addArray(files);
+
+    int nbOfProgramsAdded = 0;
+    for (auto* decoded : workerColumns) {
+        for (int column = 0; column < NB_OF_COLUMNS; column++)
+            columns[column].addArray(decoded->columns[column]);
+        for (auto fileIdx : decoded->fileIndexes)
+            sourceFileIndexes.add(firstFileIdx + fileIdx);
+        sourcePositions.addArray(decoded->positions);
+        nbOfProgramsAdded += decoded->positions.size();
+    }
+    return nbOfProgramsAdded;
+}
+
+void ProgramLibrary::clear() {
+    const ScopedWriteLock sl(libraryLock);
+    for (auto& column : columns)
+        column.clear();
+    sourceFiles.clear();
+    sourceFileIndexes.clear();
+    sourcePositions.clear();
+}
+
+int ProgramLibrary::getNumPrograms() const {
+    const ScopedReadLock sl(libraryLock);
+    return sourcePositions.size();
+}
+
+Array<int> ProgramLibrary::find(const Query& query) const {
+    const ScopedReadLock sl(libraryLock);
+    const int nbOfRows = sourcePositions.size();
+
+    // One byte per row, so the loops below only do byte arithmetic on contiguous arrays and are vectorised
+    HeapBlock<uint8_t> rowMatches(static_cast<size_t>(nbOfRows));
+    HeapBlock<uint8_t> conditionMatches(static_cast<size_t>(nbOfRows));
+    memset(rowMatches, 1, static_cast<size_t>(nbOfRows));
+
+    for (auto& condition : query.conditions) {
+        memset(conditionMatches, 0, static_cast<size_t>(nbOfRows));
+        // A single unsigned comparison checks both bounds: the values below the minimum wrap around above the range
+        const auto minValue = condition.minValue;
+        const auto range = static_cast<uint8_t>(condition.maxValue - condition.minValue);
+
+        for (int column = 0; column < NB_OF_COLUMNS; column++) {
+            if ((condition.columns & (1u << column)) == 0)
+                continue;
+            const auto* values = columns[column].begin();
+            auto* matches = conditionMatches.get();
+            for (int row = 0; row < nbOfRows; row++)
+                matches[row] |= static_cast<uint8_t>(static_cast<uint8_t>(values[row] - minValue) <= range);
+        }
+
+        auto* matches = rowMatches.get();
+        const auto* columnMatches = conditionMatches.get();
+        for (int row = 0; row < nbOfRows; row++)
+            matches[row] &= columnMatches[row];
+    }
+
+    Array<int> rows;
+    for (int row = 0; row < nbOfRows; row++)
+        if (rowMatches[row] != 0)
+            rows.add(row);
+    return rows;
+}
+
+ProgramLibrary::Source ProgramLibrary::getSource(int row) const {
+    const ScopedReadLock sl(libraryLock);
+    return {sourceFiles[sourceFileIndexes[row]], sourcePositions[row]};
+}
+
+Array<File> ProgramLibrary::getSourceFiles() const {
+    const ScopedReadLock sl(libraryLock);
+    return sourceFiles;
+}
+
+uint8_t ProgramLibrary::getValue(int row, Column column) const {
+    const ScopedReadLock sl(libraryLock);
+    return columns[column][row];
+}
@@ -0,0 +1,80 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <functional>
+#include <initializer_list>
+
+using namespace juce;
+
+// Programs decoded from libraries of .syx files, stored column by column: all the OSC 1 waves next to each other, all the
+// resonances next to each other, etc. A query only reads the columns it filters on, one byte per program, in loops the compiler
+// vectorises, so millions of programs are scanned in a few milliseconds. The columns are the fields ProgramParser knows about.
+class ProgramLibrary {
+  public:
+    // The raw values of the fields: the pitches are the total number of semitones (above 127 in LF mode), and the resonance
+    // reaches 32 and above when the filter self-oscillates.
+    enum Column { WAVE_OSC1, WAVE_OSC2, WAVE_OSC3, PITCH_OSC1, PITCH_OSC2, PITCH_OSC3, RESONANCE, NB_OF_COLUMNS };
+
+    // Programs matching every condition. A condition can be on several columns, in which case any of them may match.
+    class Query {
+      public:
+        Query& where(Column column, int minValue, int maxValue) { return whereAny({column}, minValue, maxValue); }
+        Query& whereAny(std::initializer_list<Column> columns, int minValue, int maxValue);
+
+      private:
+        friend class ProgramLibrary;
+        struct Condition {
+            uint32_t columns = 0;
+            uint8_t minValue = 0;
+            uint8_t maxValue = 255;
+        };
+        Array<Condition> conditions;
+    };
+
+    struct Source {
+        File file;
+        // Position of the program among the programs of its file
+        int position = 0;
+    };
+
+    // Loads every .syx file and librarian disk image in the folder and its subfolders, spread over all the cores. Program dumps and
+    // all-programs dumps are both read, a file can contain any number of them. Returns the number of programs added.
+    int addFolder(const File& folder);
+    int addFiles(const Array<File>& files);
+    void clear();
+    int getNumPrograms() const;
+
+    // Returns the rows of the matching programs
+    Array<int> find(const Query& query) const;
+    Source getSource(int row) const;
+    Array<File> getSourceFiles() const;
+    uint8_t getValue(int row, Column column) const;
+
+    // Calls back with the SysEx data of each program in a .syx file or a disk image, as a single program dump. Returns false if the file can't be read.
+    static bool forEachProgramInFile(const File& file, const std::function<void(const uint8_t* progData, int position)>& callback);
+    // Calls back with the SysEx data of each program dump and all-programs dump found in the bytes, without their F0 and F7
+    static void forEachDumpInData(const uint8_t* bytes, int nbOfBytes, const std::function<void(const uint8_t* sysexData, int size)>& callback);
+
+  private:
+    mutable ReadWriteLock libraryLock;
+    Array<uint8_t> columns[NB_OF_COLUMNS];
+    Array<File> sourceFiles;
+    Array<int> sourceFileIndexes;
+    Array<int> sourcePositions;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProgramLibrary)
+};
@@ -14,7 +14,7 @@
 
 #pragma once
 #include "DeviceResponse.h"
-#include <JuceHeader.h>
+#include <juce_audio_basics/juce_audio_basics.h>
 
 using namespace juce;
 
@@ -37,6 +37,53 @@ class ProgramParser {
     static constexpr int PITCH[3][2] = {{120, 121}, {140, 141}, {160, 161}};
     static const int MAX_SEMI_NORMAL_RANGE = 127;
 
+    // A program dump is the 0F 02 channel 01 header followed by the program nibbles. An all-programs dump has the
+    // same header with 02 as the command, followed by the nibbles of the 40 programs of the internal bank.
+    static const int PROG_HEADER_SIZE = 4;
+    static const int PROG_NB_OF_NIBBLES = 204;
+    static const int NB_OF_PROGS_IN_BANK = 40;
+    static const int BANK_DATA_SIZE = PROG_HEADER_SIZE + NB_OF_PROGS_IN_BANK * PROG_NB_OF_NIBBLES;
+
+    static bool isBankDump(const uint8_t* sysexData, int size) {
+        return size == BANK_DATA_SIZE && sysexData[0] == 0x0F && sysexData[1] == 0x02 && sysexData[3] == 0x02;
+    }
+    // Copies a program out of a bank dump as the SysEx data of a single program dump, and back
+    static void extractProgram(const uint8_t* bankData, int programIdx, uint8_t* progData) {
+        memcpy(progData, bankData, PROG_HEADER_SIZE);
+        progData[3] = 0x01;
+        memcpy(progData + PROG_HEADER_SIZE, bankData + PROG_HEADER_SIZE + programIdx * PROG_NB_OF_NIBBLES, PROG_NB_OF_NIBBLES);
+    }
+    static void storeProgram(uint8_t* bankData, int programIdx, const uint8_t* progData) {
+        memcpy(bankData + PROG_HEADER_SIZE + programIdx * PROG_NB_OF_NIBBLES, progData + PROG_HEADER_SIZE, PROG_NB_OF_NIBBLES);
+    }
+
+    // Parameters are split in two nibbles, the least significant one first
+    static int getNibblePair(const uint8_t* progData, const int nibbleIdx[2]) { return progData[nibbleIdx[0]] | (progData[nibbleIdx[1]] << 4); }
+    static void setNibblePair(uint8_t* progData, const int nibbleIdx[2], int value) {
+        progData[nibbleIdx[0]] = static_cast<uint8_t>(value % 16);
+        progData[nibbleIdx[1]] = static_cast<uint8_t>((value / 16) % 16);
+    }
+    // Moves the oscillator pitch in or out of the low-frequency range, keeping its position within the range
+    static void setLowFrequencyRange(uint8_t* progData, int oscNumber, bool lowFreqEnabled) {
+        const int totalNbSemi = getNibblePair(progData, PITCH[oscNumber]);
+        if (lowFreqEnabled != (totalNbSemi > MAX_SEMI_NORMAL_RANGE))
+            setNibblePair(progData, PITCH[oscNumber], lowFreqEnabled ? totalNbSemi + 128 : totalNbSemi - 128);
+    }
+    // Moves the oscillator to another octave, keeping its semitone. The low-frequency range has its own octave layout, so it's left alone.
+    static void setOctave(uint8_t* progData, int oscNumber, int octave) {
+        const int totalNbSemi = getNibblePair(progData, PITCH[oscNumber]);
+        if (totalNbSemi <= MAX_SEMI_NORMAL_RANGE)
+            setNibblePair(progData, PITCH[oscNumber], (octave + 3) * 12 + totalNbSemi % 12);
+    }
+    // Same as MidiSysexProcessor::toggleSelfOscillation: the high nibble of the resonance is shifted up by 2 to reach the 32-63 range
+    static void setSelfOscillation(uint8_t* progData, bool selfOscEnabled) {
+        const bool selfOscillating = progData[RES[1]] > 1;
+        if (selfOscEnabled && !selfOscillating)
+            progData[RES[1]] += 2;
+        else if (!selfOscEnabled && selfOscillating)
+            progData[RES[1]] -= 2;
+    }
+
   private:
     enum Oscillators { OSC1, OSC2, OSC3 };
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProgramParser)
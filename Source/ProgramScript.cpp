@@ -0,0 +1,162 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#include "ProgramScript.h"
+#include "MidiSysexProcessor.h"
+#include "ParallelFor.h"
+#include "ProgramParser.h"
+
+using namespace juce;
+
+struct ProgramScript::Context {
+    JavascriptEngine engine;
+    DynamicObject::Ptr program = new DynamicObject();
+    // The program the methods of the program object work on, changed for every call
+    uint8_t* progData = nullptr;
+};
+
+namespace {
+int getIntArgument(const var::NativeFunctionArgs& args, int argIdx) { return argIdx < args.numArguments ? static_cast<int>(args.arguments[argIdx]) : 0; }
+bool getBoolArgument(const var::NativeFunctionArgs& args, int argIdx) { return argIdx < args.numArguments && static_cast<bool>(args.arguments[argIdx]); }
+// The scripts number the oscillators from 1 like the synth does
+int getOscArgument(const var::NativeFunctionArgs& args) { return jlimit(1, 3, getIntArgument(args, 0)) - 1; }
+} // namespace
+
+ProgramScript::ProgramScript() = default;
+ProgramScript::~ProgramScript() = default;
+
+std::unique_ptr<ProgramScript::Context> ProgramScript::createContext(const String& code, Result& result) {
+    auto newContext = std::make_unique<Context>();
+    auto* ctx = newContext.get();
+    auto& program = *ctx->program;
+
+    program.setMethod("getWave", [ctx](const var::NativeFunctionArgs& args) -> var {
+        return ProgramParser::getNibblePair(ctx->progData, ProgramParser::WAVE[getOscArgument(args)]);
+    });
+    program.setMethod("setWave", [ctx](const var::NativeFunctionArgs& args) -> var {
+        ProgramParser::setNibblePair(ctx->progData, ProgramParser::WAVE[getOscArgument(args)], jlimit(0, 255, getIntArgument(args, 1)));
+        return var();
+    });
+    program.setMethod("getOctave", [ctx](const var::NativeFunctionArgs& args) -> var {
+        return (ProgramParser::getNibblePair(ctx->progData, ProgramParser::PITCH[getOscArgument(args)]) & ProgramParser::MAX_SEMI_NORMAL_RANGE) / 12 - 3;
+    });
+    program.setMethod("getSemitone", [ctx](const var::NativeFunctionArgs& args) -> var {
+        return (ProgramParser::getNibblePair(ctx->progData, ProgramParser::PITCH[getOscArgument(args)]) & ProgramParser::MAX_SEMI_NORMAL_RANGE) % 12;
+    });
+    program.setMethod("setOctave", [ctx](const var::NativeFunctionArgs& args) -> var {
+        ProgramParser::setOctave(ctx->progData, getOscArgument(args), jlimit(-3, 7, getIntArgument(args, 1)));
+        return var();
+    });
+    program.setMethod("isLowFrequency", [ctx](const var::NativeFunctionArgs& args) -> var {
+        return ProgramParser::getNibblePair(ctx->progData, ProgramParser::PITCH[getOscArgument(args)]) > ProgramParser::MAX_SEMI_NORMAL_RANGE;
+    });
+    program.setMethod("setLowFrequency", [ctx](const var::NativeFunctionArgs& args) -> var {
+        ProgramParser::setLowFrequencyRange(ctx->progData, getOscArgument(args), getBoolArgument(args, 1));
+        return var();
+    });
+    program.setMethod("isSelfOscillating", [ctx](const var::NativeFunctionArgs&) -> var { return ctx->progData[ProgramParser::RES[1]] > 1; });
+    program.setMethod("setSelfOscillation", [ctx](const var::NativeFunctionArgs& args) -> var {
+        ProgramParser::setSelfOscillation(ctx->progData, getBoolArgument(args, 0));
+        return var();
+    });
+    // The header isn't part of the program, so it's kept out of reach
+    program.setMethod("getNibble", [ctx](const var::NativeFunctionArgs& args) -> var {
+        const int nibbleIdx = getIntArgument(args, 0);
+        return isPositiveAndBelow(nibbleIdx - ProgramParser::PROG_HEADER_SIZE, ProgramParser::PROG_NB_OF_NIBBLES) ? var(ctx->progData[nibbleIdx]) : var();
+    });
+    program.setMethod("setNibble", [ctx](const var::NativeFunctionArgs& args) -> var {
+        const int nibbleIdx = getIntArgument(args, 0);
+        if (isPositiveAndBelow(nibbleIdx - ProgramParser::PROG_HEADER_SIZE, ProgramParser::PROG_NB_OF_NIBBLES))
+            ctx->progData[nibbleIdx] = static_cast<uint8_t>(getIntArgument(args, 1) & 0x0F);
+        return var();
+    });
+
+    ctx->engine.maximumExecutionTime = RelativeTime::milliseconds(MAX_EXECUTION_TIME_MS);
+    result = ctx->engine.execute(code);
+    if (result.wasOk() && !ctx->engine.getRootObjectProperties().contains("transform"))
+        result = Result::fail("The script must define a transform(program) function");
+
+    if (result.failed())
+        return nullptr;
+    return newContext;
+}
+
+Result ProgramScript::load(const String& code) {
+    const ScopedLock sl(contextLock);
+    scriptCode = code;
+
+    auto result = Result::ok();
+    context = createContext(code, result);
+    if (context == nullptr)
+        scriptCode.clear();
+    return result;
+}
+
+Result ProgramScript::runTransform(Context& ctx, uint8_t* progData, int programIdx) {
+    ctx.progData = progData;
+    ctx.program->setProperty("index", programIdx);
+
+    // The same program object is handed to every call, so running a program costs no more than the call itself
+    var programArg(ctx.program.get());
+    auto result = Result::ok();
+    ctx.engine.callFunction("transform", var::NativeFunctionArgs(var(), &programArg, 1), &result);
+    ctx.progData = nullptr;
+    return result;
+}
+
+Result ProgramScript::apply(uint8_t* progData, int programIdx) {
+    const ScopedLock sl(contextLock);
+    if (context == nullptr)
+        return Result::fail("No script is loaded");
+    return runTransform(*context, progData, programIdx);
+}
+
+Result ProgramScript::applyToBank(uint8_t* bankData) {
+    // Every worker parses this copy, so the whole bank runs the same script even if another one is loaded meanwhile
+    String code;
+    {
+        const ScopedLock sl(contextLock);
+        if (context == nullptr)
+            return Result::fail("No script is loaded");
+        code = scriptCode;
+    }
+
+    std::atomic<bool> failed{false};
+    CriticalSection errorLock;
+    String error;
+
+    // Each worker takes its own range of programs, so they never touch the same part of the bank
+    parallelFor(ProgramParser::NB_OF_PROGS_IN_BANK, [&](int, int begin, int end) {
+        auto result = Result::ok();
+        auto workerContext = createContext(code, result);
+
+        for (int programIdx = begin; workerContext != nullptr && programIdx < end && !failed.load(); programIdx++) {
+            uint8_t progData[MidiSysexProcessor::SQ_ESQ_PROG_SIZE];
+            ProgramParser::extractProgram(bankData, programIdx, progData);
+            result = runTransform(*workerContext, progData, programIdx);
+            if (result.failed()) {
+                result = Result::fail("Program " + String(programIdx + 1) + ": " + result.getErrorMessage());
+                break;
+            }
+            ProgramParser::storeProgram(bankData, programIdx, progData);
+        }
+
+        if (result.failed() && !failed.exchange(true)) {
+            const ScopedLock sl(errorLock);
+            error = result.getErrorMessage();
+        }
+    });
+
+    return failed.load() ? Result::fail(error) : Result::ok();
+}
@@ -0,0 +1,67 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+using namespace juce;
+
+// User transforms written in JavaScript, run with JUCE's JavascriptEngine. A script defines a function
+//     function transform(program) { ... }
+// that is called for each program. The program object reads and writes the nibbles through the same offsets as ProgramParser,
+// with the oscillators numbered 1 to 3 like on the synth:
+//     getWave(osc), setWave(osc, wave)                  any value from 0 to 255, including the hidden waves
+//     getOctave(osc), getSemitone(osc), setOctave(osc, octave)
+//     isLowFrequency(osc), setLowFrequency(osc, enabled)
+//     isSelfOscillating(), setSelfOscillation(enabled)
+//     getNibble(idx), setNibble(idx, value)             raw access to the program data, for everything else
+//     index                                             position of the program in its bank, 0 for a single program
+// For example, this puts every oscillator on a random hidden wave above 200 and makes the filter self-oscillate:
+//     function transform(program) {
+//         for (var osc = 1; osc <= 3; osc++)
+//             program.setWave(osc, Math.randInt(200, 256));
+//         program.setSelfOscillation(true);
+//     }
+class ProgramScript {
+  public:
+    ProgramScript();
+    ~ProgramScript();
+
+    // Parses the script and checks that it defines transform()
+    Result load(const String& code);
+    bool isLoaded() const { return context != nullptr; }
+
+    // Runs the transform on the SysEx data of a single program dump
+    Result apply(uint8_t* progData, int programIdx = 0);
+    // Runs the transform on every program of the SysEx data of a bank dump. The programs are spread over worker threads,
+    // each with its own engine since a JavascriptEngine can't be shared, so the script is only parsed once per worker.
+    Result applyToBank(uint8_t* bankData);
+
+  private:
+    struct Context;
+    static std::unique_ptr<Context> createContext(const String& code, Result& result);
+    static Result runTransform(Context& context, uint8_t* progData, int programIdx);
+
+    // A script stuck in a loop is stopped after this, instead of freezing the program
+    static const int MAX_EXECUTION_TIME_MS = 2000;
+
+    String scriptCode;
+    // Used for the single programs
+    std::unique_ptr<Context> context;
+    CriticalSection contextLock;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProgramScript)
+};
@@ -0,0 +1,229 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#include "ProgramSimilarityIndex.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <vector>
+
+using namespace juce;
+
+namespace {
+float dotProduct(const float* a, const float* b, int size) {
+    float sum = 0.0f;
+    for (int i = 0; i < size; i++)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+void normaliseLength(float* vector, int size) {
+    const auto squaredNorm = dotProduct(vector, vector, size);
+    if (squaredNorm > 0.0f)
+        FloatVectorOperations::multiply(vector, 1.0f / std::sqrt(squaredNorm), size);
+}
+} // namespace
+
+void ProgramSimilarityIndex::getRawFeatures(const uint8_t* progData, float* features) {
+    const auto* parameterNibbles = progData + ProgramParser::PROG_HEADER_SIZE + NAME_SIZE * 2;
+    for (int feature = 0; feature < FEATURE_SIZE; feature++)
+        features[feature] = static_cast<float>(parameterNibbles[feature * 2] | (parameterNibbles[feature * 2 + 1] << 4));
+}
+
+void ProgramSimilarityIndex::normalise(const Index& idx, float* features) {
+    // Standardised first so the parameters with a small range count as much as the others
+    FloatVectorOperations::subtract(features, idx.featureMeans, FEATURE_SIZE);
+    FloatVectorOperations::multiply(features, idx.featureScales, FEATURE_SIZE);
+    normaliseLength(features, FEATURE_SIZE);
+}
+
+int ProgramSimilarityIndex::build(const Array<File>& files) {
+    const auto generation = ++buildGeneration;
+    const ScopedLock buildSl(buildLock);
+    const auto isSuperseded = [this, generation] { return generation != buildGeneration.load(); };
+    if (isSuperseded())
+        return SUPERSEDED;
+
+    auto newIndex = std::make_shared<Index>();
+
+    // Read the programs, one range of files per core
+    struct WorkerPrograms {
+        Array<float> features;
+        Array<ProgramLibrary::Source> sources;
+    };
+    OwnedArray<WorkerPrograms> workerPrograms;
+    for (int worker = 0; worker < getNbOfParallelWorkers(files.size()); worker++)
+        workerPrograms.add(new WorkerPrograms());
+
+    parallelFor(files.size(), [&](int worker, int begin, int end) {
+        auto* programs = workerPrograms[worker];
+        for (int fileIdx = begin; fileIdx < end; fileIdx++) {
+            const auto file = files[fileIdx];
+            ProgramLibrary::forEachProgramInFile(file, [&](const uint8_t* progData, int position) {
+                float features[FEATURE_SIZE];
+                getRawFeatures(progData, features);
+                programs->features.addArray(features, FEATURE_SIZE);
+                programs->sources.add({file, position});
+            });
+        }
+    });
+
+    Array<float> vectors;
+    Array<ProgramLibrary::Source> sources;
+    for (auto* programs : workerPrograms) {
+        vectors.addArray(programs->features);
+        sources.addArray(programs->sources);
+    }
+    const int nbOfPrograms = sources.size();
+    if (isSuperseded())
+        return SUPERSEDED;
+    if (nbOfPrograms == 0) {
+        const SpinLock::ScopedLockType sl(indexLock);
+        index.reset();
+        return 0;
+    }
+
+    // Mean and spread of each parameter over the library
+    for (int program = 0; program < nbOfPrograms; program++)
+        FloatVectorOperations::add(newIndex->featureMeans, vectors.getRawDataPointer() + program * FEATURE_SIZE, FEATURE_SIZE);
+    FloatVectorOperations::multiply(newIndex->featureMeans, 1.0f / nbOfPrograms, FEATURE_SIZE);
+    for (int program = 0; program < nbOfPrograms; program++) {
+        const auto* features = vectors.getRawDataPointer() + program * FEATURE_SIZE;
+        for (int feature = 0; feature < FEATURE_SIZE; feature++)
+            newIndex->featureScales[feature] += square(features[feature] - newIndex->featureMeans[feature]);
+    }
+    for (auto& scale : newIndex->featureScales)
+        // A parameter that never changes carries no information
+        scale = scale > 0.0f ? 1.0f / std::sqrt(scale / nbOfPrograms) : 0.0f;
+
+    parallelFor(nbOfPrograms, [&](int, int begin, int end) {
+        for (int program = begin; program < end; program++)
+            normalise(*newIndex, vectors.getRawDataPointer() + program * FEATURE_SIZE);
+    });
+
+    Array<int> clusters;
+    runKMeans(*newIndex, vectors, clusters);
+
+    // Counting sort of the programs by cluster, so each cluster is scanned as one contiguous block
+    newIndex->clusterStarts.insertMultiple(0, 0, newIndex->nbOfClusters + 1);
+    for (auto cluster : clusters)
+        newIndex->clusterStarts.getReference(cluster + 1)++;
+    for (int cluster = 0; cluster < newIndex->nbOfClusters; cluster++)
+        newIndex->clusterStarts.getReference(cluster + 1) += newIndex->clusterStarts[cluster];
+
+    Array<int> nextPositions(newIndex->clusterStarts);
+    newIndex->features.insertMultiple(0, 0.0f, nbOfPrograms * FEATURE_SIZE);
+    newIndex->sources.resize(nbOfPrograms);
+    for (int program = 0; program < nbOfPrograms; program++) {
+        const int position = nextPositions.getReference(clusters[program])++;
+        FloatVectorOperations::copy(newIndex->features.getRawDataPointer() + position * FEATURE_SIZE, vectors.getRawDataPointer() + program * FEATURE_SIZE,
+                                    FEATURE_SIZE);
+        newIndex->sources.set(position, sources[program]);
+    }
+
+    // A newer build waits on buildLock, so it can't publish between this check and ours
+    if (isSuperseded())
+        return SUPERSEDED;
+    const SpinLock::ScopedLockType sl(indexLock);
+    index = std::move(newIndex);
+    return nbOfPrograms;
+}
+
+void ProgramSimilarityIndex::runKMeans(Index& idx, const Array<float>& vectors, Array<int>& clusters) {
+    const int nbOfPrograms = vectors.size() / FEATURE_SIZE;
+    idx.nbOfClusters = jlimit(1, 1024, roundToInt(std::sqrt(static_cast<double>(nbOfPrograms))));
+    clusters.insertMultiple(0, 0, nbOfPrograms);
+
+    // Starts from programs spread over the library, with a fixed seed so the same library gives the same index
+    Random random(0x5143);
+    for (int cluster = 0; cluster < idx.nbOfClusters; cluster++) {
+        const int program = (cluster * nbOfPrograms) / idx.nbOfClusters + random.nextInt(jmax(1, nbOfPrograms / idx.nbOfClusters));
+        idx.centroids.addArray(vectors.getRawDataPointer() + jmin(program, nbOfPrograms - 1) * FEATURE_SIZE, FEATURE_SIZE);
+    }
+
+    for (int iteration = 0; iteration < NB_OF_KMEANS_ITERATIONS; iteration++) {
+        // Every vector has unit length, so the closest centre is the one with the largest dot product
+        parallelFor(nbOfPrograms, [&](int, int begin, int end) {
+            for (int program = begin; program < end; program++) {
+                const auto* features = vectors.getRawDataPointer() + program * FEATURE_SIZE;
+                float bestScore = -2.0f;
+                for (int cluster = 0; cluster < idx.nbOfClusters; cluster++) {
+                    const auto score = dotProduct(features, idx.centroids.getRawDataPointer() + cluster * FEATURE_SIZE, FEATURE_SIZE);
+                    if (score > bestScore) {
+                        bestScore = score;
+                        clusters.getReference(program) = cluster;
+                    }
+                }
+            }
+        });
+
+        // The new centres are the normalised sums of their vectors. A centre left without vectors stays where it was.
+        Array<float> sums;
+        sums.insertMultiple(0, 0.0f, idx.nbOfClusters * FEATURE_SIZE);
+        Array<int> counts;
+        counts.insertMultiple(0, 0, idx.nbOfClusters);
+        for (int program = 0; program < nbOfPrograms; program++) {
+            FloatVectorOperations::add(sums.getRawDataPointer() + clusters[program] * FEATURE_SIZE, vectors.getRawDataPointer() + program * FEATURE_SIZE, FEATURE_SIZE);
+            counts.getReference(clusters[program])++;
+        }
+        for (int cluster = 0; cluster < idx.nbOfClusters; cluster++) {
+            if (counts[cluster] == 0)
+                continue;
+            auto* centroid = idx.centroids.getRawDataPointer() + cluster * FEATURE_SIZE;
+            FloatVectorOperations::copy(centroid, sums.getRawDataPointer() + cluster * FEATURE_SIZE, FEATURE_SIZE);
+            normaliseLength(centroid, FEATURE_SIZE);
+        }
+    }
+}
+
+int ProgramSimilarityIndex::getNumPrograms() const {
+    const SpinLock::ScopedLockType sl(indexLock);
+    return index != nullptr ? index->sources.size() : 0;
+}
+
+Array<ProgramSimilarityIndex::Match> ProgramSimilarityIndex::findSimilar(const uint8_t* progData, int maxNbOfMatches) const {
+    std::shared_ptr<const Index> currentIndex;
+    {
+        const SpinLock::ScopedLockType sl(indexLock);
+        currentIndex = index;
+    }
+    if (currentIndex == nullptr)
+        return {};
+    const auto& idx = *currentIndex;
+
+    float query[FEATURE_SIZE];
+    getRawFeatures(progData, query);
+    normalise(idx, query);
+
+    // The clusters whose centre is closest to the program
+    std::vector<std::pair<float, int>> clusterScores;
+    for (int cluster = 0; cluster < idx.nbOfClusters; cluster++)
+        clusterScores.emplace_back(dotProduct(query, idx.centroids.getRawDataPointer() + cluster * FEATURE_SIZE, FEATURE_SIZE), cluster);
+    const int nbOfProbes = jmin(idx.nbOfClusters, jmax(MIN_NB_OF_PROBES, idx.nbOfClusters / 16));
+    std::partial_sort(clusterScores.begin(), clusterScores.begin() + nbOfProbes, clusterScores.end(), std::greater<>());
+
+    std::vector<std::pair<float, int>> candidates;
+    for (int probe = 0; probe < nbOfProbes; probe++) {
+        const int cluster = clusterScores[static_cast<size_t>(probe)].second;
+        for (int program = idx.clusterStarts[cluster]; program < idx.clusterStarts[cluster + 1]; program++)
+            candidates.emplace_back(dotProduct(query, idx.features.getRawDataPointer() + program * FEATURE_SIZE, FEATURE_SIZE), program);
+    }
+
+    const auto nbOfMatches = jmin(static_cast<size_t>(maxNbOfMatches), candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + static_cast<std::ptrdiff_t>(nbOfMatches), candidates.end(), std::greater<>());
+
+    Array<Match> matches;
+    for (size_t matchIdx = 0; matchIdx < nbOfMatches; matchIdx++)
+        matches.add({idx.sources[candidates[matchIdx].second], candidates[matchIdx].first});
+    return matches;
+}
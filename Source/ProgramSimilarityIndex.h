@@ -0,0 +1,78 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#pragma once
+
+#include "ProgramLibrary.h"
+#include "ProgramParser.h"
+#include <JuceHeader.h>
+
+using namespace juce;
+
+// Finds the programs of a library that are closest to a given program. Each program becomes a feature vector of its parameter
+// bytes, standardised over the library and normalised to unit length, so the similarity of two programs is a dot product.
+// The vectors are grouped around cluster centres found with k-means, and a query only scans the clusters closest to it, which
+// keeps the queries in the milliseconds for tens of thousands of programs. The index is built on all the cores.
+class ProgramSimilarityIndex {
+  public:
+    // The 102 bytes of a program, without its 6 name characters
+    static const int NAME_SIZE = 6;
+    static const int FEATURE_SIZE = ProgramParser::PROG_NB_OF_NIBBLES / 2 - NAME_SIZE;
+
+    struct Match {
+        ProgramLibrary::Source source;
+        // 1 for the same program
+        float similarity = 0.0f;
+    };
+
+    // Returned by build() when a later build replaced it before it was done
+    static const int SUPERSEDED = -1;
+
+    // Replaces the index with the programs of the files. This blocks until the index is built, the previous index
+    // answers the queries in the meantime. Builds run one at a time and the last one started wins, the ones it
+    // overtakes are dropped. Returns the number of programs indexed, or SUPERSEDED.
+    int build(const Array<File>& files);
+    int getNumPrograms() const;
+
+    // Best matches first, for the SysEx data of a program dump
+    Array<Match> findSimilar(const uint8_t* progData, int maxNbOfMatches) const;
+
+  private:
+    struct Index {
+        int nbOfClusters = 0;
+        float featureMeans[FEATURE_SIZE] = {};
+        float featureScales[FEATURE_SIZE] = {};
+        // nbOfClusters x FEATURE_SIZE
+        Array<float> centroids;
+        // The vectors of each cluster are next to each other, the ones of cluster c start at clusterStarts[c]
+        Array<float> features;
+        Array<int> clusterStarts;
+        Array<ProgramLibrary::Source> sources;
+    };
+
+    static void getRawFeatures(const uint8_t* progData, float* features);
+    static void normalise(const Index& index, float* features);
+    static void runKMeans(Index& index, const Array<float>& vectors, Array<int>& clusters);
+
+    static const int NB_OF_KMEANS_ITERATIONS = 10;
+    // Clusters scanned by each query, out of the square root of the number of programs
+    static const int MIN_NB_OF_PROBES = 8;
+
+    std::shared_ptr<const Index> index;
+    mutable SpinLock indexLock;
+    std::atomic<uint32> buildGeneration{0};
+    CriticalSection buildLock;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProgramSimilarityIndex)
+};
@@ -0,0 +1,70 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#include "StartupProfiler.h"
+
+using namespace juce;
+
+StartupProfiler& StartupProfiler::getInstance() {
+    static StartupProfiler instance;
+    return instance;
+}
+
+void StartupProfiler::begin() {
+    const ScopedLock sl(lock);
+    startTime = Time::getMillisecondCounterHiRes();
+    finished = false;
+    stages.clear();
+}
+
+void StartupProfiler::mark(const String& stageName) {
+    const ScopedLock sl(lock);
+    if (finished)
+        return;
+    stages.add({stageName, Time::getMillisecondCounterHiRes() - startTime});
+}
+
+void StartupProfiler::finish() {
+    String summary;
+    String historyLine = Time::getCurrentTime().toISO8601(true) + "," + ProjectInfo::versionString;
+    {
+        const ScopedLock sl(lock);
+        if (finished)
+            return;
+        finished = true;
+
+        stages.add({"ready", Time::getMillisecondCounterHiRes() - startTime});
+        for (auto& stage : stages) {
+            summary << "\n    " << stage.name << ": " << String(stage.timeMs, 1) << " ms";
+            historyLine << "," << stage.name << "=" << String(stage.timeMs, 1);
+        }
+    }
+
+    Logger::writeToLog("SideQick startup:" + summary);
+
+    // Writing the history is left to a background thread, startup is over but the UI is now in use
+    Thread::launch([historyFile = getHistoryFile(), historyLine] {
+        historyFile.getParentDirectory().createDirectory();
+        StringArray history;
+        history.addLines(historyFile.loadFileAsString());
+        history.removeEmptyStrings();
+        history.add(historyLine);
+        history.removeRange(0, history.size() - MAX_NB_OF_RUNS);
+        historyFile.replaceWithText(history.joinIntoString("\n") + "\n");
+    });
+}
+
+File StartupProfiler::getHistoryFile() const {
+    return File::getSpecialLocation(File::userApplicationDataDirectory).getChildFile("SideQick").getChildFile("startup.csv");
+}
@@ -0,0 +1,50 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+using namespace juce;
+
+// Times the startup stages from the moment the application is initialised. Stages can be marked from any thread.
+// Once startup is finished, the timings are logged and appended to a history file, so cold starts can be compared between versions.
+// The history only keeps the last MAX_NB_OF_RUNS launches.
+class StartupProfiler {
+  public:
+    static StartupProfiler& getInstance();
+
+    void begin();
+    void mark(const String& stageName);
+    void finish();
+
+  private:
+    StartupProfiler() = default;
+
+    struct Stage {
+        String name;
+        double timeMs;
+    };
+
+    File getHistoryFile() const;
+
+    static const int MAX_NB_OF_RUNS = 100;
+
+    CriticalSection lock;
+    double startTime = 0.0;
+    bool finished = false;
+    Array<Stage> stages;
+
+    JUCE_DECLARE_NON_COPYABLE(StartupProfiler)
+};
@@ -0,0 +1,152 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#include "SynthSessionManager.h"
+
+using namespace juce;
+
+SynthSession::SynthSession(const MidiDeviceInfo& input, const MidiDeviceInfo& output) : deviceName(input.name), inputInfo(input), outputInfo(output) {}
+
+SynthSession::~SynthSession() {
+    // Stop receiving before anything else is destroyed
+    if (transport.input)
+        transport.input->stop();
+    ioQueue.removeAllJobs(true, 5000);
+}
+
+bool SynthSession::open() {
+    transport.input = MidiInput::openDevice(inputInfo.identifier, this);
+    transport.output = MidiOutput::openDevice(outputInfo.identifier);
+
+    if (transport.input == nullptr || transport.output == nullptr)
+        return false;
+
+    transport.input->start();
+    return true;
+}
+
+void SynthSession::enqueue(std::function<void()> job) { ioQueue.addJob(std::move(job)); }
+
+String SynthSession::getDescription() const {
+    const auto model = processor.synthState.getModel();
+    return deviceName + " - " + MODEL_NAMES[model == UNCHANGED ? UNKNOWN : model] + " on channel " + processor.getChannel();
+}
+
+void SynthSession::handleIncomingMidiMessage(MidiInput* source, const MidiMessage& message) { processor.processIncomingMidiData(message); }
+
+//==============================================================================
+void SynthSessionManager::discover(const StringArray& excludedDevices, std::function<void(int nbOfUnits)> onFinished) {
+    // Start from scratch, closing the ports of the previous discovery first so they can be opened again
+    {
+        const ScopedLock sl(sessionsLock);
+        sessions.clear();
+    }
+
+    auto outputDevices = MidiOutput::getAvailableDevices();
+    auto candidates = std::make_shared<OwnedArray<SynthSession>>();
+
+    for (auto& input : MidiInput::getAvailableDevices()) {
+        if (excludedDevices.contains(input.name))
+            continue;
+
+        for (auto& output : outputDevices) {
+            if (output.name == input.name) {
+                auto session = std::make_unique<SynthSession>(input, output);
+                if (session->open())
+                    candidates->add(session.release());
+                break;
+            }
+        }
+    }
+
+    if (candidates->isEmpty()) {
+        if (onFinished)
+            MessageManager::callAsync([onFinished] { onFinished(0); });
+        return;
+    }
+
+    // Every candidate is probed in parallel on its own queue, so discovery takes as long as a single inquiry
+    auto remaining = std::make_shared<std::atomic<int>>(candidates->size());
+    for (auto* session : *candidates) {
+        session->enqueue([this, session, candidates, remaining, onFinished] {
+            auto response = session->processor.requestDeviceInquiry();
+            session->processor.synthState.publish(response.status, response.model == UNCHANGED ? UNKNOWN : static_cast<SynthModel>(response.model),
+                                                  response.supportsHiddenWaves);
+
+            if (remaining->fetch_sub(1) == 1) {
+                MessageManager::callAsync([this, candidates, onFinished] {
+                    const ScopedLock sl(sessionsLock);
+                    for (int i = candidates->size(); --i >= 0;) {
+                        auto* candidate = candidates->getUnchecked(i);
+                        // Only keep the units that answered with a program dump
+                        if (candidate->processor.synthState.getStatus() == CONNECTED)
+                            sessions.add(candidates->removeAndReturn(i));
+                    }
+                    // The other ones are closed here rather than from their own queue's thread
+                    candidates->clear();
+                    if (onFinished)
+                        onFinished(sessions.size());
+                });
+            }
+        });
+    }
+}
+
+void SynthSessionManager::applyToAll(const SessionEdit& edit, std::function<void(int nbOfFailures, const StringArray& skippedUnits)> onFinished) {
+    const ScopedLock sl(sessionsLock);
+
+    if (sessions.isEmpty()) {
+        if (onFinished)
+            MessageManager::callAsync([onFinished] { onFinished(0, {}); });
+        return;
+    }
+
+    struct Outcome {
+        std::atomic<int> remaining;
+        std::atomic<int> failures{0};
+        StringArray skippedUnits;
+        CriticalSection skippedUnitsLock;
+    };
+    auto outcome = std::make_shared<Outcome>();
+    outcome->remaining = sessions.size();
+
+    for (auto* session : sessions) {
+        session->enqueue([session, edit, outcome, onFinished] {
+            const auto response = session->processor.synthState.getStatus() == CONNECTED ? edit(*session) : DeviceResponse(DISCONNECTED, NO_PROG);
+            if (!response.has_value()) {
+                const ScopedLock skippedLock(outcome->skippedUnitsLock);
+                outcome->skippedUnits.add(session->getDescription());
+            } else if (response->status != CONNECTED) {
+                outcome->failures.fetch_add(1);
+                session->processor.synthState.setStatus(response->status);
+            }
+
+            if (outcome->remaining.fetch_sub(1) == 1 && onFinished)
+                MessageManager::callAsync([outcome, onFinished] { onFinished(outcome->failures.load(), outcome->skippedUnits); });
+        });
+    }
+}
+
+int SynthSessionManager::getNumSessions() const {
+    const ScopedLock sl(sessionsLock);
+    return sessions.size();
+}
+
+StringArray SynthSessionManager::getSessionDescriptions() const {
+    const ScopedLock sl(sessionsLock);
+    StringArray descriptions;
+    for (auto* session : sessions)
+        descriptions.add(session->getDescription());
+    return descriptions;
+}
@@ -0,0 +1,69 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#pragma once
+
+#include "MidiDeviceTransport.h"
+#include "MidiSysexProcessor.h"
+#include <JuceHeader.h>
+#include <optional>
+
+using namespace juce;
+
+// One synth on its own pair of MIDI ports, with its own processor and its own I/O queue.
+// Jobs queued on a session run one after the other, but sessions run in parallel with each other.
+class SynthSession : public MidiInputCallback {
+  public:
+    SynthSession(const MidiDeviceInfo& input, const MidiDeviceInfo& output);
+    ~SynthSession() override;
+
+    bool open();
+    void enqueue(std::function<void()> job);
+    String getDescription() const;
+
+    MidiDeviceTransport transport;
+    MidiSysexProcessor processor{transport};
+    const String deviceName;
+
+  private:
+    void handleIncomingMidiMessage(MidiInput* source, const MidiMessage& message) override;
+
+    const MidiDeviceInfo inputInfo;
+    const MidiDeviceInfo outputInfo;
+    // Declared last so it's destroyed first, waiting for the pending jobs before the processor goes away
+    ThreadPool ioQueue{1};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SynthSession)
+};
+
+// Finds every SQ-80/ESQ-1 family unit connected to the computer and drives them concurrently
+class SynthSessionManager {
+  public:
+    // Input and output ports are paired by name, as they are on most multi-port MIDI interfaces.
+    // Ports listed in excludedDevices (the ones used by the main window) are left alone.
+    // This opens devices, so it should be called from a background thread. onFinished is called on the message thread.
+    void discover(const StringArray& excludedDevices, std::function<void(int nbOfUnits)> onFinished);
+
+    // Runs the same edit on every unit in parallel. The edit returns nothing for the units it can't be applied to, which are
+    // left alone. onFinished is called on the message thread once all of them are done, with the descriptions of the skipped units.
+    using SessionEdit = std::function<std::optional<DeviceResponse>(SynthSession& session)>;
+    void applyToAll(const SessionEdit& edit, std::function<void(int nbOfFailures, const StringArray& skippedUnits)> onFinished = nullptr);
+
+    int getNumSessions() const;
+    StringArray getSessionDescriptions() const;
+
+  private:
+    mutable CriticalSection sessionsLock;
+    OwnedArray<SynthSession> sessions;
+};
@@ -0,0 +1,48 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#pragma once
+
+#include "DeviceResponse.h"
+#include <atomic>
+
+// Connection status, model of the synth and whether it plays the hidden waves, packed in a single atomic so that the MIDI worker
+// threads and the message thread always see a consistent state without going through the UI.
+class SynthState {
+  public:
+    Status getStatus() const { return static_cast<Status>(packedState.load(std::memory_order_acquire) & 0xFF); }
+    SynthModel getModel() const { return static_cast<SynthModel>((packedState.load(std::memory_order_acquire) >> 8) & 0xFF); }
+    bool supportsHiddenWaves() const { return (packedState.load(std::memory_order_acquire) & NO_HIDDEN_WAVES) == 0; }
+    // The waves below 32 are normal waves on every model
+    bool canPlayWave(int wave) const {
+        const auto model = getModel();
+        return supportsHiddenWaves() || wave < static_cast<int>(NB_OF_WAVES[model < UNKNOWN ? model : ESQ1]);
+    }
+
+    void publish(Status status, SynthModel model, bool hiddenWaves) {
+        packedState.store(pack(status, model) | (hiddenWaves ? 0 : NO_HIDDEN_WAVES), std::memory_order_release);
+    }
+
+    void setStatus(Status status) {
+        auto current = packedState.load(std::memory_order_relaxed);
+        while (!packedState.compare_exchange_weak(current, (current & ~0xFFu) | static_cast<uint32_t>(status), std::memory_order_release, std::memory_order_relaxed))
+            ;
+    }
+
+  private:
+    static const uint32_t NO_HIDDEN_WAVES = 1u << 16;
+    static uint32_t pack(Status status, SynthModel model) { return static_cast<uint32_t>(status) | (static_cast<uint32_t>(model) << 8); }
+
+    std::atomic<uint32_t> packedState{pack(DISCONNECTED, UNKNOWN)};
+};
@@ -0,0 +1,37 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#pragma once
+#include <cstdint>
+
+// The messages sent to the SQ-80/ESQ-1 by the app and the plugin, kept here so both send the same bytes with the same timing.
+// They are for channel 1, the senders copy them and set the channel at CHANNEL_IDX.
+class SysexMessages {
+  public:
+    static constexpr uint8_t INT_BUTTON[7] = {0xF0, 0x0F, 0x02, 0x00, 0x0E, 0x26, 0xF7};
+    static constexpr uint8_t REQUEST_PGM_DUMP[6] = {0xF0, 0x0F, 0x02, 0x00, 0x09, 0xF7};
+    static constexpr uint8_t SB5[8] = {0xF0, 0x0F, 0x02, 0x00, 0x0E, 0x2F, 0x62, 0xF7};
+    static constexpr int CHANNEL_IDX = 3;
+    // We subtract 2 to exclude the SysEx header and footer
+    static constexpr int PROG_SIZE = 210 - 2;
+    // Margin given to the synth to load a program it just received, on top of the wire time
+    static constexpr double SYNTH_PROCESSING_TIME_MS = 30.0;
+
+    // Time taken by the given number of bytes on a 31.25 kbaud MIDI line (10 bits per byte)
+    static constexpr double getWireTimeMs(int nbOfBytes) { return nbOfBytes * 10 * 1000.0 / 31250.0; }
+    // Time needed to send a program to the synth, including the wire time of the surrounding button messages
+    static constexpr double getProgramSendTimeMs() {
+        return getWireTimeMs(sizeof(INT_BUTTON) + PROG_SIZE + 2 + sizeof(SB5)) + SYNTH_PROCESSING_TIME_MS;
+    }
+};
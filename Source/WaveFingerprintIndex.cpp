@@ -0,0 +1,187 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#include "WaveFingerprintIndex.h"
+#include <algorithm>
+
+using namespace juce;
+
+WaveFingerprintIndex::WaveFingerprintIndex(const File& indexFile) : indexFile(indexFile) { load(); }
+
+bool WaveFingerprintIndex::computeFingerprint(const Array<AudioAnalyzer::Result>& results, float* fingerprint, float& fundamentalHz) {
+    FloatVectorOperations::clear(fingerprint, FINGERPRINT_SIZE);
+    fundamentalHz = 0.0f;
+    int nbOfFrames = 0;
+    int nbOfPitchedFrames = 0;
+
+    for (auto& result : results) {
+        if (result.levelDb < MIN_LEVEL_DB)
+            continue;
+        FloatVectorOperations::add(fingerprint, result.bands, FINGERPRINT_SIZE);
+        nbOfFrames++;
+        if (result.fundamentalHz > 0.0f) {
+            fundamentalHz += result.fundamentalHz;
+            nbOfPitchedFrames++;
+        }
+    }
+    if (nbOfFrames == 0)
+        return false;
+    if (nbOfPitchedFrames > 0)
+        fundamentalHz /= nbOfPitchedFrames;
+
+    float squaredNorm = 0.0f;
+    for (int band = 0; band < FINGERPRINT_SIZE; band++)
+        squaredNorm += fingerprint[band] * fingerprint[band];
+    if (squaredNorm <= 0.0f)
+        return false;
+
+    FloatVectorOperations::multiply(fingerprint, 1.0f / std::sqrt(squaredNorm), FINGERPRINT_SIZE);
+    return true;
+}
+
+bool WaveFingerprintIndex::addRecording(int wave, int octave, const Array<AudioAnalyzer::Result>& results) {
+    float fingerprint[FINGERPRINT_SIZE];
+    Entry newEntry{wave, octave, 0.0f};
+    if (!computeFingerprint(results, fingerprint, newEntry.fundamentalHz))
+        return false;
+
+    const ScopedLock sl(indexLock);
+    int entryIdx = 0;
+    while (entryIdx < entries.size() && (entries[entryIdx].wave != wave || entries[entryIdx].octave != octave))
+        entryIdx++;
+
+    if (entryIdx == entries.size()) {
+        entries.add(newEntry);
+        fingerprints.insertMultiple(-1, 0.0f, FINGERPRINT_SIZE);
+    } else
+        entries.set(entryIdx, newEntry);
+
+    FloatVectorOperations::copy(fingerprints.getRawDataPointer() + entryIdx * FINGERPRINT_SIZE, fingerprint, FINGERPRINT_SIZE);
+    return true;
+}
+
+int WaveFingerprintIndex::addRecordingsFromFolder(const File& folder) {
+    int nbOfRecordingsAdded = 0;
+
+    for (auto& file : folder.findChildFiles(File::findFiles, false)) {
+        const auto name = file.getFileNameWithoutExtension().toUpperCase();
+        if (!name.startsWith("WAV"))
+            continue;
+
+        const auto wave = name.substring(3).getIntValue();
+        const auto octaveIdx = name.indexOf("OCT");
+        const auto octave = octaveIdx >= 0 ? name.substring(octaveIdx + 3).getIntValue() : 0;
+        if (!isPositiveAndBelow(wave, 256))
+            continue;
+
+        Array<AudioAnalyzer::Result> results;
+        if (AudioAnalyzer::analyseFile(file, results) && addRecording(wave, octave, results))
+            nbOfRecordingsAdded++;
+    }
+    return nbOfRecordingsAdded;
+}
+
+void WaveFingerprintIndex::clear() {
+    const ScopedLock sl(indexLock);
+    entries.clear();
+    fingerprints.clear();
+}
+
+bool WaveFingerprintIndex::findSimilar(const Array<AudioAnalyzer::Result>& results, int maxNbOfMatches, Array<Match>& matches) const {
+    float query[FINGERPRINT_SIZE];
+    float fundamentalHz;
+    if (!computeFingerprint(results, query, fundamentalHz))
+        return false;
+
+    matches.clearQuick();
+    const ScopedLock sl(indexLock);
+    matches.ensureStorageAllocated(entries.size());
+
+    // The fingerprints are unit length, so the dot product is the cosine similarity. The loop is simple enough to be vectorised.
+    const float* fingerprint = fingerprints.begin();
+    for (int entryIdx = 0; entryIdx < entries.size(); entryIdx++, fingerprint += FINGERPRINT_SIZE) {
+        float similarity = 0.0f;
+        for (int band = 0; band < FINGERPRINT_SIZE; band++)
+            similarity += query[band] * fingerprint[band];
+        matches.add({entries.getReference(entryIdx), similarity});
+    }
+
+    const auto nbOfMatches = jmin(maxNbOfMatches, matches.size());
+    std::partial_sort(matches.begin(), matches.begin() + nbOfMatches, matches.end(), [](const Match& a, const Match& b) { return a.similarity > b.similarity; });
+    matches.removeRange(nbOfMatches, matches.size() - nbOfMatches);
+    return true;
+}
+
+int WaveFingerprintIndex::getNumFingerprints() const {
+    const ScopedLock sl(indexLock);
+    return entries.size();
+}
+
+bool WaveFingerprintIndex::save() const {
+    MemoryOutputStream contents;
+    {
+        const ScopedLock sl(indexLock);
+        contents.writeInt(entries.size());
+        for (int entryIdx = 0; entryIdx < entries.size(); entryIdx++) {
+            auto& entry = entries.getReference(entryIdx);
+            contents.writeByte(static_cast<char>(entry.wave));
+            contents.writeByte(static_cast<char>(entry.octave));
+            contents.writeFloat(entry.fundamentalHz);
+            for (int band = 0; band < FINGERPRINT_SIZE; band++)
+                contents.writeFloat(fingerprints[entryIdx * FINGERPRINT_SIZE + band]);
+        }
+    }
+
+    indexFile.getParentDirectory().createDirectory();
+    indexFile.deleteFile();
+    FileOutputStream output(indexFile);
+    if (!output.openedOk())
+        return false;
+
+    output.write(FILE_MAGIC, sizeof(FILE_MAGIC));
+    output.writeByte(static_cast<char>(FILE_VERSION));
+    output.write(contents.getData(), contents.getDataSize());
+    output.flush();
+
+    return output.getStatus().wasOk();
+}
+
+bool WaveFingerprintIndex::load() {
+    FileInputStream input(indexFile);
+    if (!input.openedOk())
+        return false;
+
+    char magic[sizeof(FILE_MAGIC)];
+    if (input.read(magic, sizeof(magic)) != sizeof(magic) || memcmp(magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 || input.readByte() != FILE_VERSION)
+        return false;
+
+    const auto nbOfEntries = input.readInt();
+    const auto entrySize = 2 + static_cast<int64>(sizeof(float)) * (FINGERPRINT_SIZE + 1);
+    if (nbOfEntries < 0 || input.getNumBytesRemaining() < nbOfEntries * entrySize)
+        return false;
+
+    const ScopedLock sl(indexLock);
+    entries.clearQuick();
+    fingerprints.clearQuick();
+    for (int entryIdx = 0; entryIdx < nbOfEntries; entryIdx++) {
+        Entry entry;
+        entry.wave = static_cast<uint8_t>(input.readByte());
+        entry.octave = static_cast<int8_t>(input.readByte());
+        entry.fundamentalHz = input.readFloat();
+        entries.add(entry);
+        for (int band = 0; band < FINGERPRINT_SIZE; band++)
+            fingerprints.add(input.readFloat());
+    }
+    return true;
+}
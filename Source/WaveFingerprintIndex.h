@@ -0,0 +1,72 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#pragma once
+
+#include "AudioAnalyzer.h"
+#include <JuceHeader.h>
+
+using namespace juce;
+
+// Spectral fingerprints of waveform recordings, one per wave and octave, to find the hidden waves that sound like a sample.
+// A fingerprint is the average band spectrum of a recording, normalised to unit length, so comparing two of them is a dot product.
+// The fingerprints are stored contiguously and searched exhaustively, which only takes a few microseconds for every wave and octave.
+class WaveFingerprintIndex {
+  public:
+    static const int FINGERPRINT_SIZE = AudioAnalyzer::NB_OF_BANDS;
+
+    struct Entry {
+        int wave = 0;
+        int octave = 0;
+        float fundamentalHz = 0.0f;
+    };
+
+    struct Match {
+        Entry entry;
+        // 1 for identical spectra, 0 for spectra with nothing in common
+        float similarity = 0.0f;
+    };
+
+    WaveFingerprintIndex(const File& indexFile);
+
+    // Replaces the fingerprint for the same wave and octave, if there is one. Returns false if the recording is silent.
+    bool addRecording(int wave, int octave, const Array<AudioAnalyzer::Result>& results);
+    // Recordings are expected to be named after their wave and octave, like WAV112_OCT-1.wav. Returns the number of recordings added.
+    int addRecordingsFromFolder(const File& folder);
+    void clear();
+
+    // Best matches first. Returns false if the sample is silent.
+    bool findSimilar(const Array<AudioAnalyzer::Result>& results, int maxNbOfMatches, Array<Match>& matches) const;
+
+    int getNumFingerprints() const;
+    bool save() const;
+
+  private:
+    static bool computeFingerprint(const Array<AudioAnalyzer::Result>& results, float* fingerprint, float& fundamentalHz);
+    bool load();
+
+    static constexpr char FILE_MAGIC[4] = {'S', 'Q', 'K', 'F'};
+    static const uint8_t FILE_VERSION = 1;
+    // Frames quieter than this are left out of the fingerprints, so silence before the note does not count
+    static constexpr float MIN_LEVEL_DB = -50.0f;
+
+    const File indexFile;
+
+    mutable CriticalSection indexLock;
+    Array<Entry> entries;
+    // FINGERPRINT_SIZE floats per entry, in the same order as the entries
+    Array<float> fingerprints;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveFingerprintIndex)
+};
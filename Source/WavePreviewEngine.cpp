@@ -0,0 +1,91 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#include "WavePreviewEngine.h"
+#include "ProgramParser.h"
+
+using namespace juce;
+
+bool WavePreviewEngine::loadWaveRom(const File& romImage) {
+    MemoryBlock romData;
+    if (!romImage.loadFileAsData(romData) || romData.getSize() < static_cast<size_t>(TABLE_SIZE))
+        return false;
+
+    HeapBlock<float> newTables(NB_OF_TABLES * (TABLE_SIZE + 1));
+    const auto* romBytes = static_cast<const uint8_t*>(romData.getData());
+    const auto nbOfPages = static_cast<int>(romData.getSize() / TABLE_SIZE);
+
+    for (int table = 0; table < NB_OF_TABLES; table++) {
+        const auto* page = romBytes + (table % nbOfPages) * TABLE_SIZE;
+        auto* samples = newTables.getData() + table * (TABLE_SIZE + 1);
+        // The DOC plays unsigned 8-bit samples centred on 0x80
+        for (int i = 0; i < TABLE_SIZE; i++)
+            samples[i] = (page[i] - 128) / 128.0f;
+        samples[TABLE_SIZE] = samples[0];
+    }
+
+    const SpinLock::ScopedLockType sl(romLock);
+    tables.swapWith(newTables);
+    romLoaded.store(true);
+    return true;
+}
+
+void WavePreviewEngine::setProgram(const uint8_t* progData) {
+    for (int osc = 0; osc < 3; osc++) {
+        setWave(osc, ProgramParser::getNibblePair(progData, ProgramParser::WAVE[osc]));
+        pitches[osc].store(ProgramParser::getNibblePair(progData, ProgramParser::PITCH[osc]));
+    }
+}
+
+void WavePreviewEngine::prepare(int maxBlockSize, double newSampleRate) {
+    sampleRate = newSampleRate;
+    oscBufferSize = jmax(1, maxBlockSize);
+    oscBuffer.calloc(oscBufferSize);
+    for (auto& phase : phases)
+        phase = 0.0;
+}
+
+float WavePreviewEngine::getFrequency(int totalNbSemi) const {
+    const bool lowFreqRange = totalNbSemi > ProgramParser::MAX_SEMI_NORMAL_RANGE;
+    const auto semitones = (lowFreqRange ? totalNbSemi - 128 - LF_OCTAVE_SHIFT * 12 : totalNbSemi) - PITCH_OCT_ZERO;
+    return PREVIEW_NOTE_FREQUENCY * std::pow(2.0f, semitones / 12.0f);
+}
+
+void WavePreviewEngine::render(float* output, int nbOfSamples) {
+    FloatVectorOperations::clear(output, nbOfSamples);
+
+    const SpinLock::ScopedTryLockType sl(romLock);
+    if (!sl.isLocked() || !romLoaded.load() || oscBufferSize == 0)
+        return;
+
+    for (int osc = 0; osc < 3; osc++) {
+        const auto* table = tables.getData() + waves[osc].load(std::memory_order_relaxed) * (TABLE_SIZE + 1);
+        const auto increment = getFrequency(pitches[osc].load(std::memory_order_relaxed)) * TABLE_SIZE / sampleRate;
+        auto& phase = phases[osc];
+
+        // The table lookups can't be vectorised, so each oscillator is rendered on its own and mixed in with vector operations
+        for (int start = 0; start < nbOfSamples; start += oscBufferSize) {
+            const auto blockSize = jmin(oscBufferSize, nbOfSamples - start);
+            for (int i = 0; i < blockSize; i++) {
+                const auto index = static_cast<int>(phase);
+                const auto fraction = static_cast<float>(phase - index);
+                oscBuffer[i] = table[index] + fraction * (table[index + 1] - table[index]);
+                phase += increment;
+                if (phase >= TABLE_SIZE)
+                    phase = std::fmod(phase, static_cast<double>(TABLE_SIZE));
+            }
+            FloatVectorOperations::addWithMultiply(output + start, oscBuffer.getData(), OSC_GAIN, blockSize);
+        }
+    }
+}
@@ -0,0 +1,66 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+using namespace juce;
+
+// Software preview of the three oscillators of a program, playing from a wave ROM image dumped by the user from their own unit.
+// The layout of the waves in the ROM is not documented, so wave N is read from the Nth 256-sample page of the image, wrapping
+// around if the image is smaller. This is close enough to audition the hidden waves, which read whatever is at their address anyway.
+class WavePreviewEngine {
+  public:
+    static const int TABLE_SIZE = 256;
+    static const int NB_OF_TABLES = 256;
+
+    bool loadWaveRom(const File& romImage);
+    bool isRomLoaded() const { return romLoaded.load(); }
+
+    // Takes the waves and pitches of the three oscillators from the program. Can be called from any thread.
+    void setProgram(const uint8_t* progData);
+    void setWave(int oscNumber, int waveIndex) { waves[oscNumber].store(waveIndex & (NB_OF_TABLES - 1)); }
+
+    void prepare(int maxBlockSize, double sampleRate);
+    // Audio thread only: no allocations, and the ROM lock is only tried
+    void render(float* output, int nbOfSamples);
+
+  private:
+    float getFrequency(int totalNbSemi) const;
+
+    // The preview plays the oscillators as if middle C was held
+    static constexpr float PREVIEW_NOTE_FREQUENCY = 261.63f;
+    // Pitch value for OCT+0 SEMI+0, the pitch values start at OCT-3
+    static const int PITCH_OCT_ZERO = 36;
+    // The low-frequency range wraps around the oscillator, this approximates it as a shift of a couple of octaves down
+    static const int LF_OCTAVE_SHIFT = 2;
+    static constexpr float OSC_GAIN = 0.25f;
+
+    // One extra sample per table so the interpolation never has to wrap
+    HeapBlock<float> tables;
+    SpinLock romLock;
+    std::atomic<bool> romLoaded{false};
+
+    std::atomic<int> waves[3] = {};
+    std::atomic<int> pitches[3] = {};
+
+    double sampleRate = 44100.0;
+    double phases[3] = {};
+    HeapBlock<float> oscBuffer;
+    int oscBufferSize = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WavePreviewEngine)
+};
@@ -0,0 +1,154 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#include "WaveTranslator.h"
+#include "MidiSysexProcessor.h"
+#include "ParallelFor.h"
+#include "ProgramParser.h"
+
+using namespace juce;
+
+WaveTranslator::WaveTranslator(const File& file) : tableFile(file) {
+    resetTable();
+    if (tableFile.existsAsFile())
+        parseTable(tableFile.loadFileAsString());
+}
+
+void WaveTranslator::resetTable() {
+    for (int from = 0; from < NB_OF_FAMILIES; from++)
+        for (int to = 0; to < NB_OF_FAMILIES; to++)
+            for (int wave = 0; wave < 256; wave++)
+                // Within a family every wave is the same. Across the families, only the waves both wave lists have in common.
+                translations[from][to][wave] = from == to || wave < static_cast<int>(NB_OF_WAVES[ESQ1]) ? wave : NO_EQUIVALENT;
+    nbOfEquivalences = 0;
+}
+
+int WaveTranslator::parseTable(const String& text) {
+    int nbOfEquivalencesRead = 0;
+
+    for (auto line : StringArray::fromLines(text)) {
+        line = line.upToFirstOccurrenceOf("#", false, false).trim();
+        if (line.isEmpty())
+            continue;
+
+        // "SQ-80 112 = ESQ-1 47"
+        const auto left = StringArray::fromTokens(line.upToFirstOccurrenceOf("=", false, false), true);
+        const auto right = StringArray::fromTokens(line.fromFirstOccurrenceOf("=", false, false), true);
+        if (left.size() != 2 || right.size() != 2)
+            continue;
+
+        const auto leftModel = MODEL_NAMES.indexOf(left[0], true);
+        const auto rightModel = MODEL_NAMES.indexOf(right[0], true);
+        const auto leftWave = left[1].getIntValue();
+        const auto rightWave = right[1].getIntValue();
+        // Only the four models, not "Unknown" or "Unchanged"
+        if (!isPositiveAndNotGreaterThan(leftModel, static_cast<int>(SQ80M)) || !isPositiveAndNotGreaterThan(rightModel, static_cast<int>(SQ80M)) ||
+            !isPositiveAndBelow(leftWave, 256) || !isPositiveAndBelow(rightWave, 256))
+            continue;
+
+        const auto leftFamily = getFamily(static_cast<SynthModel>(leftModel));
+        const auto rightFamily = getFamily(static_cast<SynthModel>(rightModel));
+        translations[leftFamily][rightFamily][leftWave] = rightWave;
+        translations[rightFamily][leftFamily][rightWave] = leftWave;
+        nbOfEquivalencesRead++;
+    }
+
+    nbOfEquivalences += nbOfEquivalencesRead;
+    return nbOfEquivalencesRead;
+}
+
+int WaveTranslator::importTable(const File& file) {
+    if (!file.existsAsFile())
+        return -1;
+    const auto text = file.loadFileAsString();
+
+    const ScopedWriteLock sl(tableLock);
+    const auto nbOfEquivalencesRead = parseTable(text);
+    // The imported lines are kept with the saved ones, so the table is there on the next launch
+    if (nbOfEquivalencesRead > 0) {
+        tableFile.getParentDirectory().createDirectory();
+        tableFile.appendText(text + "\n");
+    }
+    return nbOfEquivalencesRead;
+}
+
+int WaveTranslator::getNbOfEquivalences() const {
+    const ScopedReadLock sl(tableLock);
+    return nbOfEquivalences;
+}
+
+int WaveTranslator::translate(SynthModel from, SynthModel to, int wave) const {
+    if (!isPositiveAndBelow(wave, 256))
+        return NO_EQUIVALENT;
+
+    int translatedWave;
+    {
+        const ScopedReadLock sl(tableLock);
+        translatedWave = translations[getFamily(from)][getFamily(to)][wave];
+    }
+    // The ESQ-M only plays its normal waves
+    if (to == ESQM && translatedWave >= static_cast<int>(NB_OF_WAVES[ESQM]))
+        return NO_EQUIVALENT;
+    return translatedWave;
+}
+
+bool WaveTranslator::translateProgram(uint8_t* progData, SynthModel from, SynthModel to, Array<int>* untranslatedOscs) const {
+    bool allTranslated = true;
+
+    for (int osc = 0; osc < 3; osc++) {
+        const auto wave = ProgramParser::getNibblePair(progData, ProgramParser::WAVE[osc]);
+        const auto translatedWave = translate(from, to, wave);
+        if (translatedWave == NO_EQUIVALENT) {
+            allTranslated = false;
+            if (untranslatedOscs != nullptr)
+                untranslatedOscs->add(osc);
+        } else
+            ProgramParser::setNibblePair(progData, ProgramParser::WAVE[osc], translatedWave);
+    }
+    return allTranslated;
+}
+
+WaveTranslator::BankReport WaveTranslator::translateBank(uint8_t* bankData, SynthModel from, SynthModel to) const {
+    // Each worker converts its own range of programs and reports its own problems
+    OwnedArray<BankReport> workerReports;
+    for (int worker = 0; worker < getNbOfParallelWorkers(ProgramParser::NB_OF_PROGS_IN_BANK); worker++)
+        workerReports.add(new BankReport());
+
+    parallelFor(ProgramParser::NB_OF_PROGS_IN_BANK, [&](int worker, int begin, int end) {
+        auto* report = workerReports[worker];
+        for (int programIdx = begin; programIdx < end; programIdx++) {
+            uint8_t progData[MidiSysexProcessor::SQ_ESQ_PROG_SIZE];
+            ProgramParser::extractProgram(bankData, programIdx, progData);
+
+            Array<int> untranslatedOscs;
+            translateProgram(progData, from, to, &untranslatedOscs);
+            for (auto osc : untranslatedOscs)
+                report->problems.add({programIdx, osc, ProgramParser::getNibblePair(progData, ProgramParser::WAVE[osc])});
+
+            if (memcmp(progData + ProgramParser::PROG_HEADER_SIZE, bankData + ProgramParser::PROG_HEADER_SIZE + programIdx * ProgramParser::PROG_NB_OF_NIBBLES,
+                       ProgramParser::PROG_NB_OF_NIBBLES) != 0) {
+                ProgramParser::storeProgram(bankData, programIdx, progData);
+                report->nbOfProgramsChanged++;
+            }
+        }
+    });
+
+    // The ranges are in order, so the problems stay sorted by program
+    BankReport bankReport;
+    for (auto* report : workerReports) {
+        bankReport.nbOfProgramsChanged += report->nbOfProgramsChanged;
+        bankReport.problems.addArray(report->problems);
+    }
+    return bankReport;
+}
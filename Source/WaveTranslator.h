@@ -0,0 +1,70 @@
+/*
+ * SideQick - SQ-80/ESQ-1 expansion software
+ * Copyright Vincent Zauhar, 2024
+ *
+ * Released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ *
+ * All source for SideQick is available at
+ * https://github.com/VincyZed/SideQick
+ */
+
+#pragma once
+
+#include "DeviceResponse.h"
+#include <JuceHeader.h>
+
+using namespace juce;
+
+// Converts the waves of programs from one model to another. The waves are numbered from the start of each model's wave list,
+// and the hidden waves continue past its end, so the same number doesn't play the same wave on the SQ-80 and the ESQ-1 families.
+// The ESQ-1's 32 waves are the first 32 of the SQ-80's 75, and those translate to themselves. The rest comes from an equivalence
+// table that can be imported, with one equivalence per line, for example:
+//     SQ-80 112 = ESQ-1 47
+// Models of the same family share their waves, except that the ESQ-M can't play the hidden waves.
+class WaveTranslator {
+  public:
+    static const int NO_EQUIVALENT = -1;
+
+    struct Problem {
+        int programIdx = 0;
+        int osc = 0;
+        int wave = 0;
+    };
+
+    struct BankReport {
+        int nbOfProgramsChanged = 0;
+        // The waves without an equivalent on the target model, which are left as they were
+        Array<Problem> problems;
+    };
+
+    WaveTranslator(const File& tableFile);
+
+    // Adds the equivalences of a table to the saved ones. Returns the number of equivalences read, or -1 if the file can't be read.
+    int importTable(const File& file);
+    int getNbOfEquivalences() const;
+
+    int translate(SynthModel from, SynthModel to, int wave) const;
+    // Returns false if some waves of the program have no equivalent, these oscillators are added to untranslatedOscs
+    bool translateProgram(uint8_t* progData, SynthModel from, SynthModel to, Array<int>* untranslatedOscs = nullptr) const;
+    // Converts every program of the SysEx data of a bank dump, spread over the cores
+    BankReport translateBank(uint8_t* bankData, SynthModel from, SynthModel to) const;
+
+  private:
+    enum Families { SQ80_FAMILY, ESQ1_FAMILY, NB_OF_FAMILIES };
+    static int getFamily(SynthModel model) { return model == SQ80 || model == SQ80M ? SQ80_FAMILY : ESQ1_FAMILY; }
+
+    void resetTable();
+    int parseTable(const String& text);
+
+    // Wave of the target family for each wave of the source family, or NO_EQUIVALENT
+    int translations[NB_OF_FAMILIES][NB_OF_FAMILIES][256];
+    int nbOfEquivalences = 0;
+    const File tableFile;
+    mutable ReadWriteLock tableLock;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveTranslator)
+};